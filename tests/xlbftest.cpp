@@ -0,0 +1,557 @@
+// The regression driver, which runs reference programs and random programs through the interpret and execute methods of the environment and through xlbf_run of the C interface, and compares their output and status against a plain reference interpreter.
+// The reference interpreter walks the source one command at a time, as the baseline interpreter did before the code was compiled into bytecode, hence it checks the bytecode, the memoization, the specializations, the traps, the checkpoints, the circular tapes, the origins and the tiers of the C interface at once.
+// Build from this directory and run without arguments: g++ -std=c++17 -O2 -pthread -I.. xlbftest.cpp ../xlbf.cpp -o xlbftest && ./xlbftest
+// Returns 0 if every check passes, and 1 otherwise, printing each failure.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <random>
+#include "xlbf.h"
+#include "xlbrainfuck.h"
+
+
+
+// The number of random programs compared, and the trips of loops after which a random program is dropped as too long.
+constexpr int RANDOM_PROGRAMS = 3000;
+constexpr unsigned long long RANDOM_MAX_TRIPS = 20000;
+
+// The number of runs of each program through the C interface, enough for its tier to change.
+constexpr int ABI_RUNS = 400;
+
+int failures = 0;
+
+// Records a failed check.
+void fail(const char *name, const char *what) {
+	fprintf(stderr, "FAIL %s: %s\n", name, what);
+	failures++;
+}
+
+
+
+// The result of a run: its status, output and final tape.
+template<typename storage_t>
+struct runresult {
+	int status;
+	std::string output;
+	std::vector<storage_t> tape;
+	size_t ptroffset;
+};
+
+// Runs the code as the baseline interpreter did from the origin of the tape, where an access beyond the tape is an access violation unless the tape is circular.
+// Unmatched brackets are reported as syntax errors before anything runs, whereas the environment reports them when they are reached, hence the cases with unmatched brackets write no output before them.
+// Returns false if the code takes more than maxtrips trips of loops.
+template<typename storage_t>
+bool runreference(const std::string &code, size_t tapesize, bool iscircular, size_t origin, const std::string &input, unsigned long long maxtrips, runresult<storage_t> &result) {
+	result = { STATUS_OK, std::string(), std::vector<storage_t>(tapesize, 0), 0 };
+	std::vector<size_t> matches(code.size(), 0);
+	std::vector<size_t> openstack;
+	for (size_t i = 0; i < code.size(); i++) {
+		if (code[i] == '[') {
+			openstack.push_back(i);
+		} else if (code[i] == ']') {
+			if (openstack.empty()) {
+				result.status = STATUS_SYNTAX_ERROR;
+				return true;
+			}
+			matches[i] = openstack.back();
+			matches[openstack.back()] = i;
+			openstack.pop_back();
+		}
+	}
+	if (!openstack.empty()) {
+		result.status = STATUS_SYNTAX_ERROR;
+		return true;
+	}
+	ptrdiff_t ptr = (ptrdiff_t)origin;
+	size_t inputpos = 0;
+	unsigned long long trips = 0;
+	for (size_t i = 0; i < code.size(); i++) {
+		const char command = code[i];
+		if (command == '>' || command == '<') {
+			ptr += command == '>' ? 1 : -1;
+			if (iscircular) {
+				ptr = (ptrdiff_t)((size_t)ptr & (tapesize - 1));
+			}
+			continue;
+		}
+		if (strchr("+-.,[]", command) == nullptr) {
+			continue;
+		}
+		if (ptr < 0 || ptr >= (ptrdiff_t)tapesize) {
+			result.status = STATUS_ACCESS_VIOLATION;
+			return true;
+		}
+		storage_t &cell = result.tape[(size_t)ptr];
+		if (command == '+') {
+			cell++;
+		} else if (command == '-') {
+			cell--;
+		} else if (command == '.') {
+			result.output += (char)cell;
+		} else if (command == ',') {
+			if (inputpos < input.size()) {
+				cell = (storage_t)(unsigned char)input[inputpos++];
+			}
+		} else if (command == '[') {
+			if (cell == 0) {
+				i = matches[i];
+			}
+		} else if (cell != 0) {
+			i = matches[i];
+			if (++trips > maxtrips) {
+				return false;
+			}
+		}
+	}
+	result.ptroffset = (size_t)ptr;
+	return true;
+}
+
+// The input and output of a run of the environment.
+struct testio {
+	const std::string *input;
+	size_t inputpos;
+	std::string *output;
+};
+
+void writetest(void *context, const char *data, size_t size) {
+	((testio *)context)->output->append(data, size);
+}
+
+int readtest(void *context) {
+	testio *io = (testio *)context;
+	return io->inputpos < io->input->size() ? (unsigned char)(*io->input)[io->inputpos++] : EOF;
+}
+
+// Runs the program on a fresh environment, with the profile recorded into the program if given, resuming from each breakpoint until the execution ends.
+template<typename storage_t>
+runresult<storage_t> runenv(const xl_brainfuck_program &program, size_t tapesize, bool iscircular, size_t origin, const std::string &input, bool ismemoized, xl_brainfuck_profile *profile) {
+	xl_brainfuck_env<storage_t> bfe(tapesize);
+	runresult<storage_t> result = { STATUS_OK, std::string(), std::vector<storage_t>(), 0 };
+	testio io = { &input, 0, &result.output };
+	bfe.setio({ writetest, readtest, &io });
+	bfe.setreporting(false);
+	bfe.setcircular(iscircular);
+	bfe.setorigin(origin);
+	bfe.setmemoization(ismemoized);
+	bfe.setprofile(profile);
+	result.status = bfe.execute(program);
+	while (result.status == STATUS_PAUSED) {
+		result.status = bfe.execute(program, bfe.getstate().bytecodeoffset);
+	}
+	const xl_brainfuck_state<storage_t> state = bfe.getstate();
+	result.tape.assign(state.tape, state.tape + state.tapesize);
+	result.ptroffset = state.ptroffset;
+	return result;
+}
+
+// Compares a run against the reference, where the tape is only compared if the run ended normally.
+template<typename storage_t>
+void compare(const char *name, const char *what, const runresult<storage_t> &expected, const runresult<storage_t> &actual) {
+	if (actual.status != expected.status) {
+		char message[256];
+		snprintf(message, sizeof(message), "%s ended with status %d rather than %d", what, actual.status, expected.status);
+		fail(name, message);
+	} else if (actual.output != expected.output) {
+		fail(name, (std::string(what) + " wrote different output").c_str());
+	} else if (expected.status == STATUS_OK && (actual.tape != expected.tape || actual.ptroffset != expected.ptroffset)) {
+		fail(name, (std::string(what) + " left a different tape").c_str());
+	}
+}
+
+// Runs the code through every path of the environment and compares each against the reference: memoized and not, profiled and specialized by the profile, specialized with a breakpoint on every command, and through interpret.
+template<typename storage_t>
+void checkprogram(const char *name, const std::string &code, size_t tapesize, bool iscircular, size_t origin, const std::string &input, const runresult<storage_t> &expected) {
+	xl_brainfuck_program program;
+	program.compile(code.c_str());
+	compare(name, "the memoized run", expected, runenv<storage_t>(program, tapesize, iscircular, origin, input, true, nullptr));
+	compare(name, "the plain run", expected, runenv<storage_t>(program, tapesize, iscircular, origin, input, false, nullptr));
+	xl_brainfuck_profile profile;
+	compare(name, "the profiled run", expected, runenv<storage_t>(program, tapesize, iscircular, origin, input, true, &profile));
+	xl_brainfuck_program specialized;
+	specialized.compile(code.c_str(), &profile);
+	compare(name, "the specialized run", expected, runenv<storage_t>(specialized, tapesize, iscircular, origin, input, true, nullptr));
+	for (size_t offset = 0; offset < code.size(); offset++) {
+		specialized.setbreakpoint(offset);
+	}
+	compare(name, "the run with breakpoints", expected, runenv<storage_t>(specialized, tapesize, iscircular, origin, input, true, nullptr));
+
+	// The interpret method compiles the code itself.
+	xl_brainfuck_env<storage_t> bfe(tapesize);
+	runresult<storage_t> interpreted = { STATUS_OK, std::string(), std::vector<storage_t>(), 0 };
+	testio io = { &input, 0, &interpreted.output };
+	bfe.setio({ writetest, readtest, &io });
+	bfe.setreporting(false);
+	bfe.setcircular(iscircular);
+	bfe.setorigin(origin);
+	interpreted.status = bfe.interpret(code.c_str());
+	const xl_brainfuck_state<storage_t> state = bfe.getstate();
+	interpreted.tape.assign(state.tape, state.tape + state.tapesize);
+	interpreted.ptroffset = state.ptroffset;
+	compare(name, "the interpreted run", expected, interpreted);
+}
+
+// Runs the code through the C interface many times on cells of one byte, so that the program moves through its tiers, and compares the status and output of every run against the reference.
+void checkabi(const char *name, const std::string &code, size_t tapesize, const std::string &input, const runresult<unsigned char> &expected) {
+	xlbf_program *program = xlbf_compile(code.c_str());
+	xlbf_env *env = xlbf_env_create(tapesize, 1);
+	if (program == nullptr || env == nullptr) {
+		fail(name, "the C interface could not create the program or the environment");
+		xlbf_program_free(program);
+		xlbf_env_free(env);
+		return;
+	}
+	std::vector<char> output(expected.output.size() + 1);
+	for (int run = 0; run < ABI_RUNS; run++) {
+		xlbf_env_reset(env);
+		size_t outputsize = 0;
+		const int status = xlbf_run(env, program, input.data(), input.size(), output.data(), output.size(), &outputsize);
+		xlbf_stats stats;
+		xlbf_env_getstats(env, &stats);
+		if (status != expected.status || stats.status != status ||
+			std::string(output.data(), std::min(outputsize, output.size())) != expected.output) {
+			char message[256];
+			snprintf(message, sizeof(message), "run %d through the C interface in tier %d ended with status %d, %d in its stats, rather than %d, or wrote different output",
+				run, xlbf_program_tier(program), status, stats.status, expected.status);
+			fail(name, message);
+			break;
+		}
+	}
+	xlbf_env_free(env);
+	xlbf_program_free(program);
+}
+
+// Checks that the C interface rejects an environment whose tape cannot be allocated rather than handing out one without a tape.
+void checkabicreate() {
+	xlbf_env *env = xlbf_env_create((size_t)-1 / 16, 8);
+	if (env != nullptr) {
+		fail("C interface", "an environment was created without its tape");
+		xlbf_env_free(env);
+	}
+}
+
+
+
+// A reference program with the tape it runs on.
+struct referencecase {
+	const char *name;
+	const char *code;
+	size_t tapesize;
+	bool iscircular;
+	size_t origin;
+	const char *input;
+	int status;
+};
+
+const referencecase REFERENCE_CASES[] = {
+	{ "hello", "++++++++[>++++[>++>+++>+++>+<<<<-]>+>+>->>+[<]<-]>>.>---.+++++++..+++.>>.<-.<.+++.------.--------.>>+.", 64, false, 0, "", STATUS_OK },
+	{ "echo", ",----------[++++++++++.,----------]", 8, false, 0, "echo this\n", STATUS_OK },
+	{ "scans", "+>+>+>+>+>>+>+>+[<]<[-]>>[>]<[>>>>+<<<<-]>>>>.[<<]", 64, false, 0, "", STATUS_OK },
+	{ "memoized", "+++++[>+++++[>++++[>+>++<<-]<-]<-]>>>.>.", 16, false, 0, "", STATUS_OK },
+	{ "nested", "++++[>++++[>++++[>++++<-]<-]<-]>>>[-<+>]<.", 16, false, 0, "", STATUS_OK },
+	{ "left edge", "+<+", 8, false, 0, "", STATUS_ACCESS_VIOLATION },
+	{ "right edge", "+[>+]", 8, false, 0, "", STATUS_ACCESS_VIOLATION },
+	{ "scan off the edge", "+>+>+>+[>]", 4, false, 0, "", STATUS_ACCESS_VIOLATION },
+	{ "scan left off the edge", "+>+>+>+[<]", 4, false, 0, "", STATUS_ACCESS_VIOLATION },
+	{ "unmatched begin", "+[>+", 8, false, 0, "", STATUS_SYNTAX_ERROR },
+	{ "unmatched end", "+]", 8, false, 0, "", STATUS_SYNTAX_ERROR },
+	{ "circular left", "<+++.>>>>>>>>+.", 8, true, 0, "", STATUS_OK },
+	{ "circular right", ">>>>>+++[>>>>>+<<<<<-]>>>>>.", 8, true, 0, "", STATUS_OK },
+	{ "circular scan", "+>+>>+>+>+>+>+[>]+.", 8, true, 0, "", STATUS_OK },
+	{ "circular scan left", "+>+>+>+>+>>+>+<<<<<<<[<]+.", 8, true, 0, "", STATUS_OK },
+	{ "circular alias", "+[>>>>>>>>-]+.", 8, true, 0, "", STATUS_OK },
+	{ "origin", "<<+++[>>++<<-]>>.<<<.", 8, false, 3, "", STATUS_OK },
+	{ "origin scan left", "+<+<+<<+>>>[<]+.", 8, false, 4, "", STATUS_OK },
+	{ "origin left edge", "<<<+", 8, false, 2, "", STATUS_ACCESS_VIOLATION },
+	{ "origin right edge", "+[>+]", 8, false, 5, "", STATUS_ACCESS_VIOLATION },
+	{ "origin at the end", "+<+<[->>+<<]>>.", 4, false, 3, "", STATUS_OK },
+	{ "circular origin", "<<<<<+.>>>>>>>>>+.", 8, true, 5, "", STATUS_OK },
+};
+
+// Checks the reference programs on cells of one byte and of an int, and through the C interface, which has neither circular tapes nor origins.
+void checkreferences() {
+	for (const referencecase &test : REFERENCE_CASES) {
+		runresult<unsigned char> expected;
+		runreference<unsigned char>(test.code, test.tapesize, test.iscircular, test.origin, test.input, ~0ull, expected);
+		if (expected.status != test.status) {
+			fail(test.name, "the reference interpreter disagrees with the expected status");
+			continue;
+		}
+		checkprogram<unsigned char>(test.name, test.code, test.tapesize, test.iscircular, test.origin, test.input, expected);
+		runresult<int> expectedint;
+		runreference<int>(test.code, test.tapesize, test.iscircular, test.origin, test.input, ~0ull, expectedint);
+		checkprogram<int>(test.name, test.code, test.tapesize, test.iscircular, test.origin, test.input, expectedint);
+		if (!test.iscircular && test.origin == 0) {
+			checkabi(test.name, test.code, test.tapesize, test.input, expected);
+		}
+	}
+}
+
+// Checks scans across several cache lines in both directions, which stop at the last cells of the tape while prefetching beyond it.
+void checklongscans() {
+	std::string code = ">";
+	for (int i = 0; i < 1000; i++) {
+		code += "+>";
+	}
+	code += std::string(1000, '<') + "[>]+.<[<]>.";
+	runresult<unsigned char> expected;
+	runreference<unsigned char>(code, 1002, false, 0, "", ~0ull, expected);
+	checkprogram<unsigned char>("long scans", code, 1002, false, 0, "", expected);
+	runresult<int> expectedint;
+	runreference<int>(code, 1002, false, 0, "", ~0ull, expectedint);
+	checkprogram<int>("long scans", code, 1002, false, 0, "", expectedint);
+}
+
+// Checks that a loop specialized on the trips of one input falls back to the generic loop when another input gives it a different number of trips.
+void checkdeoptimization() {
+	const char *code = ",[->+>.<<]>.";
+	xl_brainfuck_program program;
+	program.compile(code);
+	xl_brainfuck_profile profile;
+	runenv<unsigned char>(program, 8, false, 0, "\x03", true, &profile);
+	xl_brainfuck_program specialized;
+	specialized.compile(code, &profile);
+	size_t specializedloops = 0;
+	specialized.speculable(&specializedloops);
+	if (specializedloops == 0) {
+		fail("deoptimization", "the profiled loop was not specialized");
+	}
+	for (const char *input : { "\x03", "\x05", "\x01", "" }) {
+		runresult<unsigned char> expected;
+		runreference<unsigned char>(code, 8, false, 0, input, ~0ull, expected);
+		compare("deoptimization", "the specialized run", expected, runenv<unsigned char>(specialized, 8, false, 0, input, true, nullptr));
+	}
+}
+
+// Checks that deeply nested loops translated into C with the hints of their profile and the masks of a circular tape are translated whole, each loop into its head and its end.
+void checktranslation() {
+	const int depth = 64;
+	const std::string code = "+" + std::string(depth, '[') + ">+<-" + std::string(depth, ']');
+	xl_brainfuck_program program;
+	program.compile(code.c_str());
+	xl_brainfuck_profile profile;
+	runenv<int>(program, 8, true, 0, "", true, &profile);
+	xl_brainfuck_env<int> bfe(8);
+	bfe.setcircular(true);
+	std::string ccode;
+	bfe.translate(code.c_str(), ccode, &profile);
+	int heads = 0;
+	for (size_t found = ccode.find("while ("); found != std::string::npos; found = ccode.find("while (", found + 1)) {
+		heads++;
+	}
+	if (heads != depth || ccode.find("#define LIKELY") == std::string::npos || ccode.find("& 7;") == std::string::npos ||
+		std::count(ccode.begin(), ccode.end(), '{') != std::count(ccode.begin(), ccode.end(), '}') ||
+		ccode.compare(ccode.size() - 2, 2, "}\n") != 0) {
+		fail("translation", "the nested loops were not translated whole with their hints and masks");
+	}
+}
+
+// Checks that a loop which never changes its cell is reported rather than run forever, and so is a loop whose cells return to an earlier state once detection is enabled.
+void checkinfiniteloops() {
+	xl_brainfuck_env<unsigned char> bfe(8);
+	bfe.setreporting(false);
+	if (bfe.interpret("+[]") != STATUS_INFINITE_LOOP) {
+		fail("infinite loop", "a loop which never changes its cell was not reported");
+	}
+	bfe.reset();
+	bfe.setloopdetection(true);
+	if (bfe.interpret("+[>+<]") != STATUS_INFINITE_LOOP) {
+		fail("infinite loop", "a loop which only changes another cell was not detected");
+	}
+	bfe.reset();
+	if (bfe.interpret("+[>+<-]") != STATUS_OK) {
+		fail("infinite loop", "a loop which ends was reported");
+	}
+	xlbf_env *env = xlbf_env_create(8, 1);
+	xlbf_program *program = xlbf_compile("+[>+<]");
+	xlbf_env_setloopdetection(env, 1);
+	if (xlbf_run(env, program, nullptr, 0, nullptr, 0, nullptr) != XLBF_STATUS_INFINITE_LOOP) {
+		fail("infinite loop", "the C interface did not detect the loop");
+	}
+	xlbf_program_free(program);
+	xlbf_env_free(env);
+}
+
+// Checks that the error messages count against the output quota, so that an execution which uses up its output quota writes nothing past it, while a message which fits is written and counted.
+void checkquotareports() {
+	const std::string input;
+	std::string output;
+	testio io = { &input, 0, &output };
+	xl_brainfuck_env<unsigned char> bfe(8);
+	bfe.setio({ writetest, readtest, &io });
+	bfe.setquota({ 0, 0, 3, 0 });
+	if (bfe.interpret("+[.]") != STATUS_OUTPUT_QUOTA || output.size() != 3 || bfe.getusage().outputbytes != 3) {
+		fail("quota reports", "the report of the output quota was written past the quota");
+	}
+	bfe.reset();
+	output.clear();
+	bfe.setquota({ 0, 0, 200, 0 });
+	if (bfe.interpret("+.<+") != STATUS_ACCESS_VIOLATION || output.size() <= 1 || bfe.getusage().outputbytes != output.size()) {
+		fail("quota reports", "the report of an error within the output quota was not written or not counted");
+	}
+}
+
+// The state of the first checkpoint of a run.
+struct firstcheckpoint {
+	std::vector<int> tape;
+	xl_brainfuck_state<int> state;
+	bool istaken;
+};
+
+void savefirst(void *context, const xl_brainfuck_state<int> &state) {
+	firstcheckpoint *checkpoint = (firstcheckpoint *)context;
+	if (!checkpoint->istaken) {
+		checkpoint->tape.assign(state.tape, state.tape + state.tapesize);
+		checkpoint->state = state;
+		checkpoint->state.tape = checkpoint->tape.data();
+		checkpoint->istaken = true;
+	}
+}
+
+// Checks that a run resumed from its first checkpoint on a fresh environment writes the rest of the output of the whole run and leaves the same tape.
+// The code takes more trips than QUOTA_CHECK_INTERVAL, at which the first checkpoint is taken.
+void checkresume() {
+	const char *code = "++++++++[>++++++++[>++++++++<-]<-]>>[>++++++++[>++++++++[>+>++<<-]<-]>>>[-]>[-]<<<<<-.]";
+	const std::string input;
+	xl_brainfuck_program program;
+	program.compile(code);
+	const runresult<int> expected = runenv<int>(program, 16, false, 0, input, false, nullptr);
+
+	xl_brainfuck_env<int> bfe(16);
+	std::string output;
+	testio io = { &input, 0, &output };
+	bfe.setio({ writetest, readtest, &io });
+	bfe.setmemoization(false);
+	firstcheckpoint checkpoint = { std::vector<int>(), xl_brainfuck_state<int>(), false };
+	bfe.setcheckpointer({ savefirst, &checkpoint, 0 });
+	if (bfe.execute(program) != STATUS_OK || !checkpoint.istaken) {
+		fail("checkpoint resume", "the run took no checkpoint");
+		return;
+	}
+
+	xl_brainfuck_env<int> resumed(16);
+	runresult<int> result = { STATUS_OK, expected.output.substr(0, (size_t)checkpoint.state.usage.outputbytes), std::vector<int>(), 0 };
+	testio resumedio = { &input, 0, &result.output };
+	resumed.setio({ writetest, readtest, &resumedio });
+	resumed.setmemoization(false);
+	if (!resumed.restore(checkpoint.state)) {
+		fail("checkpoint resume", "the checkpoint does not fit the tape");
+		return;
+	}
+	result.status = resumed.execute(program, checkpoint.state.bytecodeoffset);
+	const xl_brainfuck_state<int> state = resumed.getstate();
+	result.tape.assign(state.tape, state.tape + state.tapesize);
+	result.ptroffset = state.ptroffset;
+	compare("checkpoint resume", "the resumed run", expected, result);
+}
+
+// Checks that an execution stepped back and forth on a timeline ends in the state of an uninterrupted run, with the input replayed and no output written twice, and that the environment is left with its memoization as it was.
+void checktimeline() {
+	const char *code = ",.[-]++++++++[>++++++++[>++++++++<-]<-]>>[>++++++++[>++++++++[>+>++<<-]<-]>>>[-]>[-]<<<<<-.]";
+	const std::string input = "t";
+	xl_brainfuck_program program;
+	program.compile(code);
+	const runresult<int> expected = runenv<int>(program, 16, false, 0, input, false, nullptr);
+
+	xl_brainfuck_env<int> bfe(16);
+	runresult<int> result = { STATUS_OK, std::string(), std::vector<int>(), 0 };
+	testio io = { &input, 0, &result.output };
+	bfe.setreporting(false);
+	bfe.setmemoization(true);
+	{
+		xl_brainfuck_timeline<int> timeline(bfe, program, { writetest, readtest, &io });
+		timeline.forward(60000);
+		timeline.backward(40000);
+		timeline.forward(0);
+		if (!timeline.backtochange(3)) {
+			fail("timeline", "the last change of a cell was not found");
+		}
+		timeline.backward(10000);
+		result.status = timeline.forward(0);
+	}
+	if (!bfe.getmemoization()) {
+		fail("timeline", "the timeline left memoization disabled");
+	}
+	const xl_brainfuck_state<int> state = bfe.getstate();
+	result.tape.assign(state.tape, state.tape + state.tapesize);
+	result.ptroffset = state.ptroffset;
+	compare("timeline", "the run on the timeline", expected, result);
+}
+
+// Checks that the pointer returns to the origin when the environment is reset, and that an origin beyond the tape is rejected.
+void checkreset() {
+	xl_brainfuck_env<unsigned char> bfe(8);
+	bfe.setreporting(false);
+	if (bfe.setorigin(8) || !bfe.setorigin(3)) {
+		fail("origin", "the origin was not checked against the tape");
+	}
+	bfe.interpret(">>+<<<<<+");
+	bfe.reset();
+	const xl_brainfuck_state<unsigned char> state = bfe.getstate();
+	if (state.ptroffset != 3 || state.tape[5] != 0 || state.tape[0] != 0) {
+		fail("origin", "the reset did not clear the tape and return the pointer to the origin");
+	}
+}
+
+
+
+// Generates a random program of balanced loops, made mostly of the patterns which the compiler optimizes.
+std::string randomcode(std::mt19937_64 &random, int depth) {
+	static const char *PATTERNS[] = { "[-]", "[>]", "[<<]", "[->+<]", "[->>+<<]", "[-<+>]", ".", "," };
+	std::string code;
+	const int count = (int)(random() % 10) + 1;
+	for (int i = 0; i < count; i++) {
+		const int kind = (int)(random() % 10);
+		if (kind < 3) {
+			code += std::string(random() % 4 + 1, "+-"[random() % 2]);
+		} else if (kind < 6) {
+			code += std::string(random() % 4 + 1, "<>"[random() % 2]);
+		} else if (kind < 8 || depth >= 3) {
+			code += PATTERNS[random() % (sizeof(PATTERNS) / sizeof(PATTERNS[0]))];
+		} else {
+			code += "[" + randomcode(random, depth + 1) + "]";
+		}
+	}
+	return code;
+}
+
+// Compares random programs on bounded and circular tapes from random origins, dropping those which the reference does not finish within RANDOM_MAX_TRIPS trips.
+void checkrandom() {
+	std::mt19937_64 random(1);
+	int compared = 0;
+	for (int i = 0; i < RANDOM_PROGRAMS; i++) {
+		const bool iscircular = i % 2 == 1;
+		const size_t tapesize = iscircular ? (size_t)1 << (random() % 5 + 1) : (size_t)(random() % 24 + 1);
+		const size_t origin = (size_t)(random() % tapesize);
+		const std::string code = randomcode(random, 0);
+		const std::string input = "xyz";
+		runresult<unsigned char> expected;
+		if (!runreference<unsigned char>(code, tapesize, iscircular, origin, input, RANDOM_MAX_TRIPS, expected)) {
+			continue;
+		}
+		const std::string name = "random program " + code;
+		checkprogram<unsigned char>(name.c_str(), code, tapesize, iscircular, origin, input, expected);
+		compared++;
+	}
+	printf("Compared %d random programs.\n", compared);
+}
+
+
+
+int main() {
+	checkreferences();
+	checkabicreate();
+	checklongscans();
+	checkdeoptimization();
+	checktranslation();
+	checkinfiniteloops();
+	checkquotareports();
+	checkresume();
+	checktimeline();
+	checkreset();
+	checkrandom();
+	printf(failures == 0 ? "All checks passed.\n" : "%d checks failed.\n", failures);
+	return failures == 0 ? 0 : 1;
+}
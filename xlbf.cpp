@@ -0,0 +1,211 @@
+// The shared library which exposes the brainfuck environment through the C interface declared in xlbf.h.
+// The environments of the different cell sizes are hidden behind the opaque xlbf_env, and no C++ exception is allowed to cross the interface: every function which may throw catches all exceptions and reports them as an error status, a null pointer or a zero result.
+#define XLBF_BUILD
+#include <new>
+#include "xlbf.h"
+#include "xlbrainfuck.h"
+
+
+
+// The input and output buffers of a run.
+struct xlbf_runio {
+	const char *input;
+	size_t inputsize;
+	size_t inputpos;
+	char *output;
+	size_t outputcapacity;
+	size_t outputsize;
+};
+
+// Copies the output into the buffer as far as it fits, and counts all of it.
+void xlbf_writebuffer(void *context, const char *data, size_t size) {
+	xlbf_runio *io = (xlbf_runio *)context;
+	if (io->outputsize < io->outputcapacity) {
+		const size_t copied = std::min(size, io->outputcapacity - io->outputsize);
+		memcpy(io->output + io->outputsize, data, copied);
+	}
+	io->outputsize += size;
+}
+
+int xlbf_readbuffer(void *context) {
+	xlbf_runio *io = (xlbf_runio *)context;
+	return io->inputpos < io->inputsize ? (unsigned char)io->input[io->inputpos++] : EOF;
+}
+
+
+
+// A program which chooses its tier by itself over its runs, see xl_brainfuck_adaptiveprogram.
+struct xlbf_program {
+	xl_brainfuck_adaptiveprogram program;
+
+	xlbf_program(const char *code) : program(code) {
+	}
+};
+
+// An environment of any cell size, see xlbf_typedenv.
+struct xlbf_env {
+	virtual ~xlbf_env() {}
+	virtual void reset() = 0;
+	virtual void setquota(const xl_brainfuck_quota &quota) = 0;
+	virtual void setloopdetection(bool enabled) = 0;
+	virtual int run(xl_brainfuck_adaptiveprogram &program, xlbf_runio &io) = 0;
+	virtual void getstats(xlbf_stats &stats) = 0;
+	virtual bool isready() const = 0;
+};
+
+// An environment whose cells are of the storage type.
+template<typename storage_t>
+struct xlbf_typedenv : xlbf_env {
+
+	xl_brainfuck_env<storage_t> bfe;
+
+	// The status of the latest run if it ended by an exception, which the environment cannot record by itself, or XLBF_STATUS_OK otherwise.
+	int failure;
+
+	xlbf_typedenv(size_t tapesize) : bfe(tapesize), failure(XLBF_STATUS_OK) {
+		this->bfe.setreporting(false);
+	}
+
+	void reset() override {
+		this->bfe.reset();
+	}
+
+	void setquota(const xl_brainfuck_quota &quota) override {
+		this->bfe.setquota(quota);
+	}
+
+	void setloopdetection(bool enabled) override {
+		this->bfe.setloopdetection(enabled);
+	}
+
+	int run(xl_brainfuck_adaptiveprogram &program, xlbf_runio &io) override {
+		this->bfe.setio({ xlbf_writebuffer, xlbf_readbuffer, &io });
+		int status = XLBF_STATUS_OK;
+		this->failure = XLBF_STATUS_OK;
+		try {
+			status = program.execute(this->bfe);
+		} catch (const std::bad_alloc &) {
+			this->failure = XLBF_STATUS_OUT_OF_MEMORY;
+		} catch (...) {
+			this->failure = XLBF_STATUS_INTERNAL_ERROR;
+		}
+		this->bfe.setio({ writestdout, readconsole, nullptr });
+		return this->failure != XLBF_STATUS_OK ? this->failure : status;
+	}
+
+	bool isready() const override {
+		return this->bfe.isready();
+	}
+
+	void getstats(xlbf_stats &stats) override {
+		const xl_brainfuck_error error = this->bfe.geterror();
+		const xl_brainfuck_usage usage = this->bfe.getusage();
+		stats.status = this->failure != XLBF_STATUS_OK ? this->failure : error.status;
+		stats.erroroffset = this->failure != XLBF_STATUS_OK ? 0 : error.sourceoffset;
+		stats.steps = usage.steps;
+		stats.outputbytes = usage.outputbytes;
+		stats.seconds = usage.seconds;
+	}
+
+};
+
+
+
+extern "C" {
+
+XLBF_API int xlbf_version(void) {
+	return XLBF_VERSION;
+}
+
+XLBF_API xlbf_program *xlbf_compile(const char *code) {
+	try {
+		return new xlbf_program(code);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+XLBF_API size_t xlbf_program_size(const xlbf_program *program) {
+	try {
+		return program->program.size();
+	} catch (...) {
+		return 0;
+	}
+}
+
+XLBF_API void xlbf_program_free(xlbf_program *program) {
+	delete program;
+}
+
+XLBF_API xlbf_env *xlbf_env_create(size_t tapesize, int cellsize) {
+	if (tapesize == 0) {
+		return nullptr;
+	}
+	xlbf_env *env = nullptr;
+	try {
+		switch (cellsize) {
+		case 1:
+			env = new xlbf_typedenv<unsigned char>(tapesize);
+			break;
+		case 2:
+			env = new xlbf_typedenv<unsigned short>(tapesize);
+			break;
+		case 4:
+			env = new xlbf_typedenv<unsigned>(tapesize);
+			break;
+		case 8:
+			env = new xlbf_typedenv<unsigned long long>(tapesize);
+			break;
+		default:
+			return nullptr;
+		}
+	} catch (...) {
+		return nullptr;
+	}
+	// The environment does not throw when its tape cannot be allocated, but is left without a tape.
+	if (!env->isready()) {
+		delete env;
+		return nullptr;
+	}
+	return env;
+}
+
+XLBF_API void xlbf_env_free(xlbf_env *env) {
+	delete env;
+}
+
+XLBF_API void xlbf_env_reset(xlbf_env *env) {
+	env->reset();
+}
+
+XLBF_API void xlbf_env_setquota(xlbf_env *env, const xlbf_quota *quota) {
+	env->setquota({ quota->steps, quota->pages, quota->outputbytes, quota->seconds });
+}
+
+XLBF_API void xlbf_env_setloopdetection(xlbf_env *env, int enabled) {
+	env->setloopdetection(enabled != 0);
+}
+
+XLBF_API int xlbf_run(xlbf_env *env, const xlbf_program *program, const char *input, size_t inputsize,
+	char *output, size_t outputcapacity, size_t *outputsize) {
+	xlbf_runio io = { input, inputsize, 0, output, outputcapacity, 0 };
+	const int status = env->run(const_cast<xlbf_program *>(program)->program, io);
+	if (outputsize != nullptr) {
+		*outputsize = io.outputsize;
+	}
+	return status;
+}
+
+XLBF_API void xlbf_env_getstats(const xlbf_env *env, xlbf_stats *stats) {
+	const_cast<xlbf_env *>(env)->getstats(*stats);
+}
+
+XLBF_API int xlbf_program_tier(const xlbf_program *program) {
+	try {
+		return program->program.gettier();
+	} catch (...) {
+		return XLBF_TIER_BASELINE;
+	}
+}
+
+}
@@ -0,0 +1,124 @@
+/*
+BRAINFUCK LIBRARY:
+
+< Outline >
+# This header declares the C interface of libxlbf, a shared library which embeds the brainfuck environment of xlbrainfuck.h in other programs and languages through their foreign function interfaces. The interface uses only C types and opaque handles, so that it stays stable as the environment evolves: functions and fields of structures are only ever added at the end, and the values of the status codes never change.
+# A program is compiled once with xlbf_compile and may be run any number of times on any number of environments. An environment is created with xlbf_env_create, holds a tape of a fixed size and type, and keeps its tape and pointer between runs until it is reset. Each run reads its input from a buffer and writes its output into a buffer supplied by the caller.
+# Programs may be shared between threads, while each environment must be used by one thread at a time.
+
+< Building >
+# The library is built from xlbf.cpp, for example with GCC or Clang:
+	$ g++ -std=c++17 -O2 -shared -fPIC -fvisibility=hidden xlbf.cpp -o libxlbf.so
+# On Windows, the library is built as a DLL with XLBF_BUILD defined, for example cl /std:c++17 /O2 /LD /DXLBF_BUILD xlbf.cpp /Fe:xlbf.dll.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#if defined(XLBF_BUILD)
+#define XLBF_API __declspec(dllexport)
+#else
+#define XLBF_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define XLBF_API __attribute__((visibility("default")))
+#else
+#define XLBF_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+// The version of the interface, which is incremented whenever functions or fields are added.
+#define XLBF_VERSION 2
+
+// The status of a run, which matches xl_brainfuck_status.
+#define XLBF_STATUS_OK 0
+#define XLBF_STATUS_SYNTAX_ERROR 1
+#define XLBF_STATUS_ACCESS_VIOLATION 2
+#define XLBF_STATUS_INFINITE_LOOP 3
+#define XLBF_STATUS_STEP_QUOTA 4
+#define XLBF_STATUS_MEMORY_QUOTA 5
+#define XLBF_STATUS_OUTPUT_QUOTA 6
+#define XLBF_STATUS_TIME_QUOTA 7
+#define XLBF_STATUS_OUT_OF_MEMORY 9
+#define XLBF_STATUS_INTERNAL_ERROR 10
+
+// The tier in which a program runs, which matches xl_brainfuck_tier.
+#define XLBF_TIER_BASELINE 0
+#define XLBF_TIER_PROFILING 1
+#define XLBF_TIER_SPECIALIZED 2
+
+// A compiled brainfuck program, and a brainfuck environment.
+typedef struct xlbf_program xlbf_program;
+typedef struct xlbf_env xlbf_env;
+
+// The resource quotas of an environment, where a limit of zero means no limit. See xl_brainfuck_quota.
+typedef struct xlbf_quota {
+	unsigned long long steps;
+	size_t pages;
+	size_t outputbytes;
+	double seconds;
+} xlbf_quota;
+
+// The statistics of an environment: the status and source offset of the error which ended the latest run, if any, and the resources used since the quotas were last set.
+typedef struct xlbf_stats {
+	int status;
+	size_t erroroffset;
+	unsigned long long steps;
+	size_t outputbytes;
+	double seconds;
+} xlbf_stats;
+
+// Returns XLBF_VERSION of the library, which may be newer than the header the caller was built with.
+XLBF_API int xlbf_version(void);
+
+// Compiles a block of brainfuck code terminated by '\0', and returns the program or NULL if memory runs out.
+// Unenclosed loops are not rejected here, but reported as syntax errors when they are reached in a run.
+// The program chooses how it runs by itself: it starts out as plain bytecode, and once the time spent in its runs pays for it, a few runs are profiled and the program is recompiled with the loops specialized that the profile supports, unless that turns out slower. See xlbf_program_tier.
+XLBF_API xlbf_program *xlbf_compile(const char *code);
+
+// Returns the size of the bytecode of the current tier of the program in bytes.
+XLBF_API size_t xlbf_program_size(const xlbf_program *program);
+
+// Frees a program, which may be NULL.
+XLBF_API void xlbf_program_free(xlbf_program *program);
+
+// Creates an environment with a tape of tapesize cells of cellsize bytes each, where the cell size is 1, 2, 4 or 8, and returns it or NULL if the arguments are invalid or memory runs out.
+// Error messages are not written to the output of the environment, as the status of each run is returned instead.
+XLBF_API xlbf_env *xlbf_env_create(size_t tapesize, int cellsize);
+
+// Frees an environment, which may be NULL.
+XLBF_API void xlbf_env_free(xlbf_env *env);
+
+// Resets the tape of the environment to zero and moves the pointer to the start of the tape.
+XLBF_API void xlbf_env_reset(xlbf_env *env);
+
+// Sets the resource quotas of the environment and clears the resources used so far.
+XLBF_API void xlbf_env_setquota(xlbf_env *env, const xlbf_quota *quota);
+
+// Enables or disables the detection of infinite loops at run time, which is disabled by default.
+XLBF_API void xlbf_env_setloopdetection(xlbf_env *env, int enabled);
+
+// Runs the program on the environment with the input of inputsize bytes, and returns the status of the run, which is XLBF_STATUS_OUT_OF_MEMORY if memory runs out within the interpreter, such as in the memoization of loops, and XLBF_STATUS_INTERNAL_ERROR if the run fails in any other way. After either, the environment should be reset before it runs again.
+// The output is written into the buffer of outputcapacity bytes, and the number of bytes produced is stored into outputsize. Like snprintf, the output beyond the capacity is dropped but still counted, so that the caller can detect the truncation and retry with a larger buffer. The input and output may be NULL if their sizes are zero, and outputsize may be NULL.
+// At the end of the input, the cell is left unchanged.
+XLBF_API int xlbf_run(xlbf_env *env, const xlbf_program *program, const char *input, size_t inputsize,
+	char *output, size_t outputcapacity, size_t *outputsize);
+
+// Stores the statistics of the environment.
+XLBF_API void xlbf_env_getstats(const xlbf_env *env, xlbf_stats *stats);
+
+// Returns the tier in which the next run of the program executes, one of XLBF_TIER_BASELINE, XLBF_TIER_PROFILING and XLBF_TIER_SPECIALIZED.
+XLBF_API int xlbf_program_tier(const xlbf_program *program);
+
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,959 @@
+// The batch runner application which runs a list of brainfuck jobs on a pool of worker threads, or of worker processes for isolation from crashes.
+// Each worker is pinned to a core and allocates its tape and output buffer on the NUMA node of that core by touching them first. Jobs are queued per node, and a worker takes jobs from the queue of its own node before stealing from the nearest other nodes.
+// On systems without NUMA information the workers are pinned to the cores of a single node, and on systems other than Linux they are not pinned at all.
+// Each worker takes its jobs in batches, reading the files of the next batch ahead while the current batch runs and writing the outputs of a batch after it has run, through io_uring on Linux so that the files of a whole batch cost a few system calls.
+// Worker processes take their jobs from queues in memory shared with the supervisor, and record the progress of each job there, so that the supervisor can fail the job which crashed a worker, restart the worker, and run the other jobs of the worker again.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <thread>
+#include <algorithm>
+#if defined(__linux__)
+#include <sched.h>
+#include <dirent.h>
+#endif
+#if !defined(_WIN32)
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#endif
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define XLBF_BATCH_URING
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#include "xlbrainfuck.h"
+
+
+
+// The initial capacity of the output buffers of each worker, which are touched by the worker when it starts.
+constexpr size_t WORKER_OUTPUT_RESERVE = 1 << 16;
+
+// The number of jobs that a worker takes at once, whose files are read and written together.
+constexpr size_t WORKER_BATCH_SIZE = 16;
+
+// The initial size of the buffers into which files are read in batches. A buffer grows to the largest file read into it, and a file which does not fit is read again synchronously.
+constexpr size_t BATCH_READ_SIZE = 1 << 12;
+
+
+
+// The phases of a job, from which the supervisor tells the job that crashed a worker from the jobs that the worker has taken but not finished.
+enum jobphase {
+	JOB_QUEUED,
+	JOB_TAKEN,
+	JOB_RUNNING,
+	JOB_RAN,
+	JOB_DONE
+};
+
+// The progress of a job and the worker which has taken it, and the result of the job once it is done.
+struct jobstate {
+	std::atomic<int> phase;
+	std::atomic<int> worker;
+	std::atomic<int> result;
+};
+
+// A job of the batch, which runs the brainfuck source file on the content of the input file and writes the output into the output file.
+// The input file may be given as - for no input.
+// The output is written into the partial file next to the output file first, which is renamed to the output file once it is complete, so that a job whose worker dies while writing never leaves a truncated output file behind.
+struct batchjob {
+	std::string bfsrc;
+	std::string input;
+	std::string output;
+	std::string partial;
+	jobstate *state;
+};
+
+// A NUMA node with the CPUs that workers are pinned to, the jobs queued on the node, and the order in which the other nodes are stolen from.
+struct batchnode {
+	int id;
+	std::vector<int> cpus;
+	std::vector<size_t> jobs;
+	std::atomic<size_t> *nextjob;
+	std::vector<size_t> stealorder;
+};
+
+// The state of the batch which changes as the workers run, which is placed in memory shared with the worker processes: the position in the queue of each node, the state of each job, and the jobs of crashed workers to run again.
+// The jobs to run again are only appended by the supervisor, and taken by the workers before any other jobs.
+struct batchshared {
+	std::atomic<size_t> *nextjobs;
+	jobstate *jobstates;
+	size_t *retryjobs;
+	std::atomic<size_t> retrycount;
+	std::atomic<size_t> nextretry;
+};
+
+static_assert(std::atomic<size_t>::is_always_lock_free && std::atomic<int>::is_always_lock_free,
+	"The atomics shared between processes must be lock-free.");
+
+// The input and output of the job being run by a worker.
+struct jobio {
+	const std::string *input;
+	size_t inputpos;
+	std::string *output;
+};
+
+void writejob(void *context, const char *data, size_t size) {
+	((jobio *)context)->output->append(data, size);
+}
+
+// Reads 0 at the end of the input, as most brainfuck programs expect.
+int readjob(void *context) {
+	jobio *io = (jobio *)context;
+	return io->inputpos < io->input->size() ? (unsigned char)(*io->input)[io->inputpos++] : 0;
+}
+
+
+
+// Reads the whole content of a file into the buffer, and returns false if the file cannot be read.
+bool readfile(const char *path, std::string &buffer) {
+	FILE *fp = fopen(path, "rb");
+	if (fp == nullptr) {
+		return false;
+	}
+	buffer.clear();
+	char chunk[4096];
+	size_t chunksize;
+	while ((chunksize = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+		buffer.append(chunk, chunksize);
+	}
+	fclose(fp);
+	return true;
+}
+
+// Writes the content of the buffer into a file, and returns false if the file cannot be written.
+bool writefile(const char *path, const std::string &buffer) {
+	FILE *fp = fopen(path, "wb");
+	if (fp == nullptr) {
+		return false;
+	}
+	const bool written = fwrite(buffer.data(), 1, buffer.size(), fp) == buffer.size();
+	return fclose(fp) == 0 && written;
+}
+
+// Parses a list of CPUs such as "0-3,8-11" as found in the sysfs.
+std::vector<int> parsecpulist(const char *cpulist) {
+	std::vector<int> cpus;
+	const char *listptr = cpulist;
+	while (*listptr != 0 && *listptr != '\n') {
+		char *endptr;
+		const long first = strtol(listptr, &endptr, 10);
+		long last = first;
+		if (endptr == listptr) {
+			break;
+		}
+		if (*endptr == '-') {
+			listptr = endptr + 1;
+			last = strtol(listptr, &endptr, 10);
+		}
+		for (long cpu = first; cpu <= last; cpu++) {
+			cpus.push_back((int)cpu);
+		}
+		listptr = *endptr == ',' ? endptr + 1 : endptr;
+	}
+	return cpus;
+}
+
+// Discovers the NUMA nodes and the CPUs of each node that this process may run on.
+// Falls back to a single node with all usable CPUs if the NUMA topology is unknown, where a CPU of -1 stands for an unpinned worker.
+std::vector<std::unique_ptr<batchnode>> discovernodes() {
+	std::vector<std::unique_ptr<batchnode>> nodes;
+	std::vector<int> allowedcpus;
+#if defined(__linux__)
+	cpu_set_t allowedset;
+	CPU_ZERO(&allowedset);
+	if (sched_getaffinity(0, sizeof(allowedset), &allowedset) == 0) {
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET(cpu, &allowedset)) {
+				allowedcpus.push_back(cpu);
+			}
+		}
+	}
+	DIR *nodedir = opendir("/sys/devices/system/node");
+	if (nodedir != nullptr) {
+		struct dirent *entry;
+		while ((entry = readdir(nodedir)) != nullptr) {
+			int id;
+			char suffix;
+			if (sscanf(entry->d_name, "node%d%c", &id, &suffix) != 1) {
+				continue;
+			}
+			std::string cpulist;
+			if (!readfile(("/sys/devices/system/node/" + std::string(entry->d_name) + "/cpulist").c_str(), cpulist)) {
+				continue;
+			}
+			std::unique_ptr<batchnode> node(new batchnode());
+			node->id = id;
+			for (int cpu : parsecpulist(cpulist.c_str())) {
+				if (std::find(allowedcpus.begin(), allowedcpus.end(), cpu) != allowedcpus.end()) {
+					node->cpus.push_back(cpu);
+				}
+			}
+			if (!node->cpus.empty()) {
+				nodes.push_back(std::move(node));
+			}
+		}
+		closedir(nodedir);
+	}
+	std::sort(nodes.begin(), nodes.end(), [](const std::unique_ptr<batchnode> &a, const std::unique_ptr<batchnode> &b) {
+		return a->id < b->id;
+	});
+#endif
+	if (nodes.empty()) {
+		std::unique_ptr<batchnode> node(new batchnode());
+		node->id = 0;
+		node->cpus = allowedcpus;
+		if (node->cpus.empty()) {
+			node->cpus.assign(std::max(1u, std::thread::hardware_concurrency()), -1);
+		}
+		nodes.push_back(std::move(node));
+	}
+
+	// Orders the other nodes by their distance as reported by the sysfs, so that the workers steal from the nearest nodes first.
+	for (size_t i = 0; i < nodes.size(); i++) {
+		std::vector<long> distances(nodes.size(), 0);
+#if defined(__linux__)
+		std::string distancelist;
+		if (readfile(("/sys/devices/system/node/node" + std::to_string(nodes[i]->id) + "/distance").c_str(), distancelist)) {
+			std::vector<long> nodedistances;
+			const char *listptr = distancelist.c_str();
+			char *endptr;
+			for (long distance = strtol(listptr, &endptr, 10); endptr != listptr; distance = strtol(listptr, &endptr, 10)) {
+				nodedistances.push_back(distance);
+				listptr = endptr;
+			}
+			for (size_t j = 0; j < nodes.size(); j++) {
+				if ((size_t)nodes[j]->id < nodedistances.size()) {
+					distances[j] = nodedistances[nodes[j]->id];
+				}
+			}
+		}
+#endif
+		for (size_t j = 0; j < nodes.size(); j++) {
+			if (j != i) {
+				nodes[i]->stealorder.push_back(j);
+			}
+		}
+		std::stable_sort(nodes[i]->stealorder.begin(), nodes[i]->stealorder.end(), [&](size_t a, size_t b) {
+			return distances[a] < distances[b];
+		});
+	}
+	return nodes;
+}
+
+// Takes the next job of a crashed worker to run again, or returns false if there is none.
+bool takeretry(batchshared &shared, size_t &jobindex) {
+	size_t position = shared.nextretry.load();
+	while (position < shared.retrycount.load()) {
+		if (shared.nextretry.compare_exchange_weak(position, position + 1)) {
+			jobindex = shared.retryjobs[position];
+			return true;
+		}
+	}
+	return false;
+}
+
+// Creates the shared state of the batch for the nodes and jobs, and points them to their parts of it.
+// The state is placed in memory which worker processes forked afterwards share, except on Windows where the workers are always threads.
+batchshared *createshared(std::vector<std::unique_ptr<batchnode>> &nodes, std::vector<batchjob> &jobs) {
+	const size_t size = sizeof(batchshared) + nodes.size() * sizeof(std::atomic<size_t>)
+		+ jobs.size() * (sizeof(jobstate) + sizeof(size_t));
+#if defined(_WIN32)
+	void *memory = calloc(1, size);
+#else
+	void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) {
+		memory = nullptr;
+	}
+#endif
+	if (memory == nullptr) {
+		return nullptr;
+	}
+	batchshared *shared = new (memory) batchshared();
+	shared->nextjobs = (std::atomic<size_t> *)(shared + 1);
+	shared->jobstates = (jobstate *)(shared->nextjobs + nodes.size());
+	shared->retryjobs = (size_t *)(shared->jobstates + jobs.size());
+	for (size_t i = 0; i < nodes.size(); i++) {
+		nodes[i]->nextjob = new (&shared->nextjobs[i]) std::atomic<size_t>(0);
+	}
+	for (size_t i = 0; i < jobs.size(); i++) {
+		jobs[i].state = new (&shared->jobstates[i]) jobstate();
+		jobs[i].state->worker = -1;
+	}
+	return shared;
+}
+
+// Records that the job has finished with the result.
+void finishjob(batchjob &job, int result) {
+	job.state->result = result;
+	job.state->phase = JOB_DONE;
+}
+
+// Renames the complete partial file of the job to its output file, and returns false if it cannot be renamed, in which case the partial file is removed.
+bool publishoutput(const batchjob &job) {
+#if defined(_WIN32)
+	remove(job.output.c_str());
+#endif
+	if (rename(job.partial.c_str(), job.output.c_str()) != 0) {
+		remove(job.partial.c_str());
+		return false;
+	}
+	return true;
+}
+
+// Pins the calling thread to the CPU, unless the CPU is -1.
+void pinthread(int cpu) {
+#if defined(__linux__)
+	if (cpu >= 0) {
+		cpu_set_t cpuset;
+		CPU_ZERO(&cpuset);
+		CPU_SET(cpu, &cpuset);
+		sched_setaffinity(0, sizeof(cpuset), &cpuset);
+	}
+#endif
+}
+
+// Takes the next job from the queue of the node, or returns false if the queue is exhausted.
+bool takejob(batchnode &node, size_t &jobindex) {
+	const size_t position = node.nextjob->fetch_add(1, std::memory_order_relaxed);
+	if (position >= node.jobs.size()) {
+		return false;
+	}
+	jobindex = node.jobs[position];
+	return true;
+}
+
+
+
+
+// A file which is read into the buffer or written from it by the batch I/O.
+// The file is pending from the time its I/O is queued until the I/O has completed, after which ok tells whether it succeeded.
+struct batchfile {
+	const char *path;
+	std::string *buffer;
+	bool iswrite;
+	bool pending;
+	bool ok;
+	unsigned slot;
+	unsigned remaining;
+	long result;
+};
+
+// Reads and writes the files of a worker in batches.
+// On Linux each file is opened into a registered slot of an io_uring, and read or written and closed by linked requests, so that the files queued between two submissions cost a single system call. A file whose requests fail, which needs Linux 5.15 for the opening into slots, or which does not fit into its buffer is read or written again synchronously, which also detects the errors of the file.
+// Where io_uring is unavailable the files are read and written synchronously as they are queued, and the workers themselves make up the thread pool of the I/O.
+class batchio {
+
+private:
+
+	int ringfd;
+
+#if defined(XLBF_BATCH_URING)
+	void *sqring;
+	size_t sqringsize;
+	void *cqring;
+	size_t cqringsize;
+	io_uring_sqe *sqes;
+	size_t sqessize;
+	unsigned *sqhead;
+	unsigned *sqtail;
+	unsigned sqmask;
+	unsigned sqentries;
+	unsigned *sqarray;
+	unsigned *cqhead;
+	unsigned *cqtail;
+	unsigned cqmask;
+	unsigned cqentries;
+	io_uring_cqe *cqes;
+	// The requests which are queued but not submitted, and the requests whose completions are not reaped yet.
+	unsigned queued;
+	unsigned inflight;
+	std::vector<unsigned> freeslots;
+
+	// Sets up the ring with a slot for each of the files which may be pending at once, and returns false if io_uring or any of its operations is unavailable.
+	bool setupring(unsigned maxfiles) {
+		unsigned entries = 1;
+		while (entries * 2 < maxfiles * 3) {
+			entries <<= 1;
+		}
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		this->ringfd = (int)syscall(__NR_io_uring_setup, entries, &params);
+		if (this->ringfd < 0) {
+			return false;
+		}
+		this->sqringsize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		this->cqringsize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+			this->sqringsize = this->cqringsize = std::max(this->sqringsize, this->cqringsize);
+		}
+		this->sqring = mmap(nullptr, this->sqringsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ringfd, IORING_OFF_SQ_RING);
+		if (this->sqring == MAP_FAILED) {
+			this->sqring = nullptr;
+			return false;
+		}
+		if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+			this->cqring = this->sqring;
+		} else {
+			this->cqring = mmap(nullptr, this->cqringsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ringfd, IORING_OFF_CQ_RING);
+			if (this->cqring == MAP_FAILED) {
+				this->cqring = nullptr;
+				return false;
+			}
+		}
+		this->sqessize = params.sq_entries * sizeof(io_uring_sqe);
+		this->sqes = (io_uring_sqe *)mmap(nullptr, this->sqessize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ringfd, IORING_OFF_SQES);
+		if (this->sqes == MAP_FAILED) {
+			this->sqes = nullptr;
+			return false;
+		}
+		char *sqbase = (char *)this->sqring;
+		char *cqbase = (char *)this->cqring;
+		this->sqhead = (unsigned *)(sqbase + params.sq_off.head);
+		this->sqtail = (unsigned *)(sqbase + params.sq_off.tail);
+		this->sqmask = *(unsigned *)(sqbase + params.sq_off.ring_mask);
+		this->sqentries = params.sq_entries;
+		this->sqarray = (unsigned *)(sqbase + params.sq_off.array);
+		this->cqhead = (unsigned *)(cqbase + params.cq_off.head);
+		this->cqtail = (unsigned *)(cqbase + params.cq_off.tail);
+		this->cqmask = *(unsigned *)(cqbase + params.cq_off.ring_mask);
+		this->cqentries = params.cq_entries;
+		this->cqes = (io_uring_cqe *)(cqbase + params.cq_off.cqes);
+
+		// Probes the operations, which older kernels lack even where the ring itself is available.
+		std::vector<char> probebuffer(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+		io_uring_probe *probe = (io_uring_probe *)probebuffer.data();
+		if (syscall(__NR_io_uring_register, this->ringfd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+			return false;
+		}
+		for (unsigned op : { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE }) {
+			if (op > probe->last_op || (probe->ops[op].flags & IO_URING_OP_SUPPORTED) == 0) {
+				return false;
+			}
+		}
+		const std::vector<int> slots(maxfiles, -1);
+		if (syscall(__NR_io_uring_register, this->ringfd, IORING_REGISTER_FILES, slots.data(), maxfiles) < 0) {
+			return false;
+		}
+		for (unsigned slot = maxfiles; slot > 0; slot--) {
+			this->freeslots.push_back(slot - 1);
+		}
+		return true;
+	}
+
+	// Unmaps and closes whatever part of the ring has been set up.
+	void closering() {
+		if (this->sqes != nullptr) {
+			munmap(this->sqes, this->sqessize);
+		}
+		if (this->cqring != nullptr && this->cqring != this->sqring) {
+			munmap(this->cqring, this->cqringsize);
+		}
+		if (this->sqring != nullptr) {
+			munmap(this->sqring, this->sqringsize);
+		}
+		if (this->ringfd >= 0) {
+			close(this->ringfd);
+		}
+		this->sqring = this->cqring = nullptr;
+		this->sqes = nullptr;
+		this->ringfd = -1;
+	}
+
+	// Fills the next entry of the submission queue, which is cleared first, and returns it.
+	io_uring_sqe &nextsqe(unsigned position, unsigned char opcode, int fd, unsigned char flags) {
+		const unsigned index = (*this->sqtail + position) & this->sqmask;
+		io_uring_sqe &sqe = this->sqes[index];
+		memset(&sqe, 0, sizeof(sqe));
+		sqe.opcode = opcode;
+		sqe.fd = fd;
+		sqe.flags = flags;
+		this->sqarray[index] = index;
+		return sqe;
+	}
+
+	// Queues the opening of the file into its slot, the read or write, and the closing of the slot, linked so that each starts after the previous one whether it succeeded or not.
+	void queuering(batchfile &file) {
+		if (this->queued + 3 > this->sqentries) {
+			this->submit();
+		}
+		while (this->inflight + 3 > this->cqentries) {
+			this->reap(true);
+		}
+		file.slot = this->freeslots.back();
+		this->freeslots.pop_back();
+		file.remaining = 2;
+		file.result = -1;
+
+		io_uring_sqe &opensqe = this->nextsqe(0, IORING_OP_OPENAT, AT_FDCWD, IOSQE_IO_HARDLINK);
+		opensqe.addr = (unsigned long long)file.path;
+		opensqe.len = file.iswrite ? 0666 : 0;
+		opensqe.open_flags = file.iswrite ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY;
+		opensqe.file_index = file.slot + 1;
+		io_uring_sqe &iosqe = this->nextsqe(1, file.iswrite ? IORING_OP_WRITE : IORING_OP_READ, (int)file.slot, IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK);
+		iosqe.addr = (unsigned long long)&(*file.buffer)[0];
+		iosqe.len = (unsigned)file.buffer->size();
+		iosqe.user_data = (unsigned long long)&file;
+		io_uring_sqe &closesqe = this->nextsqe(2, IORING_OP_CLOSE, 0, 0);
+		closesqe.file_index = file.slot + 1;
+		closesqe.user_data = (unsigned long long)&file | 1;
+
+		__atomic_store_n(this->sqtail, *this->sqtail + 3, __ATOMIC_RELEASE);
+		this->queued += 3;
+		this->inflight += 3;
+	}
+
+	// Reaps the completions in the queue, first waiting for one if the queue is empty and the wait is requested.
+	// The completion of the read or write carries its result, and the completion of the closing frees the slot, after which the file is finished.
+	void reap(bool wait) {
+		unsigned head = *this->cqhead;
+		if (wait && head == __atomic_load_n(this->cqtail, __ATOMIC_ACQUIRE) && this->inflight > this->queued) {
+			syscall(__NR_io_uring_enter, this->ringfd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+		}
+		const unsigned tail = __atomic_load_n(this->cqtail, __ATOMIC_ACQUIRE);
+		for (; head != tail; head++) {
+			const io_uring_cqe &cqe = this->cqes[head & this->cqmask];
+			this->inflight--;
+			if (cqe.user_data == 0) {
+				continue;
+			}
+			batchfile &file = *(batchfile *)(cqe.user_data & ~1ull);
+			if ((cqe.user_data & 1) == 0) {
+				file.result = cqe.res;
+			} else {
+				this->freeslots.push_back(file.slot);
+			}
+			if (--file.remaining == 0) {
+				finish(file, file.result);
+			}
+		}
+		__atomic_store_n(this->cqhead, head, __ATOMIC_RELEASE);
+	}
+#endif
+
+	// Finishes the I/O of the file with the number of bytes read or written, or -1, falling back to synchronous I/O unless the whole file has been read or written.
+	static void finish(batchfile &file, long result) {
+		if (file.iswrite) {
+			file.ok = result == (long)file.buffer->size() || writefile(file.path, *file.buffer);
+		} else if (result >= 0 && (size_t)result < file.buffer->size()) {
+			file.buffer->resize(result);
+			file.ok = true;
+		} else {
+			file.ok = readfile(file.path, *file.buffer);
+		}
+		file.pending = false;
+	}
+
+public:
+
+	// Sets up the batch I/O for at most maxfiles files pending at once.
+	batchio(unsigned maxfiles) : ringfd(-1) {
+#if defined(XLBF_BATCH_URING)
+		this->sqring = this->cqring = nullptr;
+		this->sqes = nullptr;
+		this->queued = this->inflight = 0;
+		if (!this->setupring(maxfiles)) {
+			this->closering();
+		}
+#endif
+	}
+
+	~batchio() {
+#if defined(XLBF_BATCH_URING)
+		if (this->ringfd >= 0) {
+			this->submit();
+			while (this->inflight > 0) {
+				this->reap(true);
+			}
+		}
+		this->closering();
+#endif
+	}
+
+	// Returns whether the files are read and written through io_uring.
+	bool isasync() const {
+		return this->ringfd >= 0;
+	}
+
+	// Queues the read or write of the file, which must stay in place with its buffer until the file is completed.
+	void queue(batchfile &file) {
+		file.pending = true;
+		file.ok = false;
+		if (!file.iswrite) {
+			file.buffer->resize(std::max(file.buffer->capacity(), BATCH_READ_SIZE));
+		}
+#if defined(XLBF_BATCH_URING)
+		if (this->ringfd >= 0 && !this->freeslots.empty() && file.buffer->size() <= 0xffffffffu) {
+			this->queuering(file);
+			return;
+		}
+#endif
+		finish(file, -1);
+	}
+
+	// Submits the queued files to the kernel without waiting for them.
+	void submit() {
+#if defined(XLBF_BATCH_URING)
+		while (this->queued > 0) {
+			const long submitted = syscall(__NR_io_uring_enter, this->ringfd, this->queued, 0, 0, nullptr, 0);
+			if (submitted > 0) {
+				this->queued -= (unsigned)submitted;
+			} else if (errno != EINTR) {
+				this->reap(true);
+			}
+		}
+#endif
+	}
+
+	// Submits the queued files and waits until the files have completed.
+	void complete(std::vector<batchfile> &files) {
+#if defined(XLBF_BATCH_URING)
+		this->submit();
+		for (batchfile &file : files) {
+			while (file.pending) {
+				this->reap(true);
+			}
+		}
+#endif
+	}
+
+};
+
+// The jobs which a worker takes at once, with the buffers and files of their sources, inputs and outputs.
+struct workerbatch {
+	std::vector<size_t> jobs;
+	std::vector<std::string> sources;
+	std::vector<std::string> inputs;
+	std::vector<std::string> outputs;
+	std::vector<batchfile> sourcefiles;
+	std::vector<batchfile> inputfiles;
+	std::vector<batchfile> outputfiles;
+};
+
+// Takes the next batch of jobs for the worker, from the jobs of crashed workers, the queue of its own node and the queues of the nearest other nodes in turn, and queues the reads of their files.
+void takebatch(int worker, std::vector<std::unique_ptr<batchnode>> &nodes, size_t nodeindex, size_t &stealposition,
+	std::vector<batchjob> &jobs, batchshared &shared, batchio &io, workerbatch &batch) {
+	batchnode &node = *nodes[nodeindex];
+	batch.jobs.clear();
+	size_t jobindex = 0;
+	while (batch.jobs.size() < WORKER_BATCH_SIZE) {
+		if (!takeretry(shared, jobindex) && !takejob(node, jobindex)) {
+			while (stealposition < node.stealorder.size() && !takejob(*nodes[node.stealorder[stealposition]], jobindex)) {
+				stealposition++;
+			}
+			if (stealposition == node.stealorder.size()) {
+				break;
+			}
+		}
+		const size_t i = batch.jobs.size();
+		batch.jobs.push_back(jobindex);
+		const batchjob &job = jobs[jobindex];
+		job.state->worker = worker;
+		job.state->phase = JOB_TAKEN;
+		batch.sourcefiles[i].path = job.bfsrc.c_str();
+		io.queue(batch.sourcefiles[i]);
+		if (job.input == "-") {
+			batch.inputs[i].clear();
+			batch.inputfiles[i].path = nullptr;
+			batch.inputfiles[i].ok = true;
+		} else {
+			batch.inputfiles[i].path = job.input.c_str();
+			io.queue(batch.inputfiles[i]);
+		}
+		batch.outputfiles[i].path = nullptr;
+	}
+}
+
+// Waits until the outputs of the batch have been written, renames them to the output files, and finishes the jobs, failing those whose output files cannot be written.
+void completeoutputs(batchio &io, workerbatch &batch, std::vector<batchjob> &jobs) {
+	io.complete(batch.outputfiles);
+	for (size_t i = 0; i < batch.jobs.size(); i++) {
+		batchjob &job = jobs[batch.jobs[i]];
+		const batchfile &file = batch.outputfiles[i];
+		if (file.path != nullptr) {
+			if (!file.ok) {
+				remove(job.partial.c_str());
+			}
+			const bool ispublished = file.ok && publishoutput(job);
+			if (!ispublished) {
+				fprintf(stderr, "Unable to create output file %s.\n", job.output.c_str());
+			}
+			finishjob(job, ispublished ? job.state->result.load() : 1);
+		}
+	}
+	batch.jobs.clear();
+}
+
+// Runs jobs on a worker pinned to the CPU until the queues of all nodes are exhausted.
+void runworker(int worker, int cpu, size_t nodeindex, long memsize,
+	std::vector<std::unique_ptr<batchnode>> &nodes, std::vector<batchjob> &jobs, batchshared &shared) {
+
+	pinthread(cpu);
+
+	// Allocates and touches the tape and the output buffers after pinning, so that their pages are placed on the node of the worker.
+	xl_brainfuck_env<int> bfe(memsize);
+	bfe.reset();
+	workerbatch batches[2];
+	for (workerbatch &batch : batches) {
+		batch.sources.resize(WORKER_BATCH_SIZE);
+		batch.inputs.resize(WORKER_BATCH_SIZE);
+		batch.outputs.resize(WORKER_BATCH_SIZE);
+		for (size_t i = 0; i < WORKER_BATCH_SIZE; i++) {
+			batch.outputs[i].resize(WORKER_OUTPUT_RESERVE);
+			batch.outputs[i].clear();
+			batch.sourcefiles.push_back({ nullptr, &batch.sources[i], false, false, false, 0, 0, 0 });
+			batch.inputfiles.push_back({ nullptr, &batch.inputs[i], false, false, false, 0, 0, 0 });
+			batch.outputfiles.push_back({ nullptr, &batch.outputs[i], true, false, false, 0, 0, 0 });
+		}
+	}
+	batchio io(2 * 3 * WORKER_BATCH_SIZE);
+
+	jobio jio = { nullptr, 0, nullptr };
+	bfe.setio({ writejob, readjob, &jio });
+	// Fails the jobs stuck in infinite loops rather than letting them hold the worker.
+	bfe.setloopdetection(true);
+
+	// Alternates between two batches, so that the files of the next batch are read and the outputs of the previous batch are written while the current batch runs.
+	size_t stealposition = 0;
+	size_t current = 0;
+	takebatch(worker, nodes, nodeindex, stealposition, jobs, shared, io, batches[current]);
+	while (!batches[current].jobs.empty()) {
+		workerbatch &batch = batches[current];
+		workerbatch &next = batches[current ^ 1];
+		completeoutputs(io, next, jobs);
+		takebatch(worker, nodes, nodeindex, stealposition, jobs, shared, io, next);
+		io.complete(batch.sourcefiles);
+		io.complete(batch.inputfiles);
+		for (size_t i = 0; i < batch.jobs.size(); i++) {
+			batchjob &job = jobs[batch.jobs[i]];
+			if (!batch.sourcefiles[i].ok) {
+				fprintf(stderr, "Unable to read brainfuck source file %s.\n", job.bfsrc.c_str());
+				finishjob(job, 1);
+				continue;
+			}
+			if (!batch.inputfiles[i].ok) {
+				fprintf(stderr, "Unable to read input file %s.\n", job.input.c_str());
+				finishjob(job, 1);
+				continue;
+			}
+			jio.input = &batch.inputs[i];
+			jio.inputpos = 0;
+			jio.output = &batch.outputs[i];
+			batch.outputs[i].clear();
+			bfe.reset();
+			job.state->phase = JOB_RUNNING;
+			job.state->result = bfe.interpret(batch.sources[i].c_str());
+			job.state->phase = JOB_RAN;
+			batch.outputfiles[i].path = job.partial.c_str();
+			io.queue(batch.outputfiles[i]);
+		}
+		io.submit();
+		current ^= 1;
+	}
+	completeoutputs(io, batches[current ^ 1], jobs);
+
+}
+
+
+#if !defined(_WIN32)
+
+// Forks a worker process which runs jobs until the queues are exhausted, and returns its process id.
+// If the process cannot be forked, the worker runs within the supervisor instead and -1 is returned.
+pid_t forkworker(int worker, int cpu, size_t nodeindex, long memsize,
+	std::vector<std::unique_ptr<batchnode>> &nodes, std::vector<batchjob> &jobs, batchshared &shared) {
+	const pid_t pid = fork();
+	if (pid == 0) {
+		runworker(worker, cpu, nodeindex, memsize, nodes, jobs, shared);
+		_exit(0);
+	}
+	if (pid < 0) {
+		fprintf(stderr, "Unable to fork worker %d, which runs within the supervisor instead.\n", worker);
+		runworker(worker, cpu, nodeindex, memsize, nodes, jobs, shared);
+	}
+	return pid;
+}
+
+// Recovers the jobs of a crashed worker: fails the job that it was running, and queues the other jobs that it has taken but not finished to run again.
+// The output of a job only reaches its output file once it is complete, hence a job whose output the worker was writing runs again from scratch, and the partial files of the failed jobs are removed.
+// If the worker crashed outside of any job, all of its unfinished jobs are failed instead, so that a worker which keeps crashing cannot keep its jobs running forever.
+void recoverjobs(int worker, std::vector<batchjob> &jobs, batchshared &shared) {
+	size_t crashedjob = jobs.size();
+	for (size_t i = 0; i < jobs.size(); i++) {
+		if (jobs[i].state->worker == worker && jobs[i].state->phase == JOB_RUNNING) {
+			crashedjob = i;
+		}
+	}
+	for (size_t i = 0; i < jobs.size(); i++) {
+		jobstate &state = *jobs[i].state;
+		if (state.worker != worker || state.phase == JOB_QUEUED || state.phase == JOB_DONE) {
+			continue;
+		}
+		if (i == crashedjob) {
+			fprintf(stderr, "Brainfuck source file %s crashed its worker.\n", jobs[i].bfsrc.c_str());
+			remove(jobs[i].partial.c_str());
+			finishjob(jobs[i], 1);
+		} else if (crashedjob == jobs.size() || shared.retrycount == jobs.size()) {
+			fprintf(stderr, "Job of brainfuck source file %s was lost with its worker.\n", jobs[i].bfsrc.c_str());
+			remove(jobs[i].partial.c_str());
+			finishjob(jobs[i], 1);
+		} else {
+			state.worker = -1;
+			state.phase = JOB_QUEUED;
+			shared.retryjobs[shared.retrycount] = i;
+			shared.retrycount++;
+		}
+	}
+}
+
+#endif
+
+// Execution in command line: xlbfbatch memsize jobfile [workers] [-processes]
+// Each line of the job file lists the brainfuck source file, the input file and the output file of a job, separated by whitespace.
+// With -processes, the workers are processes which a supervisor restarts when they crash, rather than threads.
+int main(int argc, char **argv) {
+
+	// Ensures that the correct number of arguments has been passed.
+	bool useprocesses = false;
+	if (argc > 3 && strcmp(argv[argc - 1], "-processes") == 0) {
+		useprocesses = true;
+		argc--;
+	}
+	if (argc != 3 && argc != 4) {
+		fprintf(stderr, "You must specify the size of memory allocated to each brainfuck environment and the job file.\n");
+		fprintf(stderr, "Follow this format in command line: xlbfbatch memsize jobfile [workers] [-processes].\n");
+		return 1;
+	}
+#if defined(_WIN32)
+	if (useprocesses) {
+		fprintf(stderr, "Worker processes are not supported on Windows.\n");
+		return 1;
+	}
+#endif
+
+	// Processes the arguments and determines if they are valid.
+	const long memsize = strtol(argv[1], nullptr, 10);
+	if (memsize <= 0) {
+		fprintf(stderr, "You must supply a valid positive integer for the size of memory allocated.\n");
+		return 1;
+	}
+	std::string joblist;
+	if (!readfile(argv[2], joblist)) {
+		fprintf(stderr, "Invalid job file.\n");
+		return 1;
+	}
+	std::vector<batchjob> jobs;
+	const char *lineptr = joblist.c_str();
+	while (*lineptr != 0) {
+		char bfsrc[1024], input[1024], output[1024];
+		const char *lineend = strchr(lineptr, '\n');
+		const std::string line(lineptr, lineend == nullptr ? strlen(lineptr) : lineend - lineptr);
+		if (sscanf(line.c_str(), "%1023s %1023s %1023s", bfsrc, input, output) == 3 && bfsrc[0] != '#') {
+			jobs.push_back({ bfsrc, input, output, std::string(output) + ".partial", nullptr });
+		}
+		lineptr += line.size() + (lineend == nullptr ? 0 : 1);
+	}
+
+	// Determines the workers and their CPUs, interleaving the nodes so that a pool smaller than the machine still spreads over all nodes.
+	std::vector<std::unique_ptr<batchnode>> nodes = discovernodes();
+	std::vector<std::pair<int, size_t>> workercpus;
+	size_t maxnodecpus = 0;
+	for (const auto &node : nodes) {
+		maxnodecpus = std::max(maxnodecpus, node->cpus.size());
+	}
+	for (size_t rank = 0; rank < maxnodecpus; rank++) {
+		for (size_t i = 0; i < nodes.size(); i++) {
+			if (rank < nodes[i]->cpus.size()) {
+				workercpus.push_back({ nodes[i]->cpus[rank], i });
+			}
+		}
+	}
+	const long workers = argc == 4 ? strtol(argv[3], nullptr, 10) : (long)workercpus.size();
+	if (workers <= 0) {
+		fprintf(stderr, "You must supply a valid positive integer for the number of workers.\n");
+		return 1;
+	}
+
+	// Queues the jobs on the nodes in proportion to their workers.
+	std::vector<size_t> workernodes;
+	for (long worker = 0; worker < workers; worker++) {
+		workernodes.push_back(workercpus[worker % workercpus.size()].second);
+	}
+	for (size_t i = 0; i < jobs.size(); i++) {
+		nodes[workernodes[i % workernodes.size()]]->jobs.push_back(i);
+	}
+	batchshared *shared = createshared(nodes, jobs);
+	if (shared == nullptr) {
+		fprintf(stderr, "Unable to allocate the shared state of the batch.\n");
+		return 1;
+	}
+	fprintf(stderr, "Running %u jobs on %ld worker %s over %u NUMA nodes with %s I/O ...\n",
+		(unsigned)jobs.size(), workers, useprocesses ? "processes" : "threads", (unsigned)nodes.size(),
+		batchio(1).isasync() ? "io_uring" : "synchronous");
+
+	if (!useprocesses) {
+		std::vector<std::thread> threads;
+		for (long worker = 0; worker < workers; worker++) {
+			threads.emplace_back(runworker, (int)worker, workercpus[worker % workercpus.size()].first, workernodes[worker],
+				memsize, std::ref(nodes), std::ref(jobs), std::ref(*shared));
+		}
+		for (std::thread &thread : threads) {
+			thread.join();
+		}
+	}
+#if !defined(_WIN32)
+	else {
+		// Supervises the workers, restarting each crashed worker once its jobs are recovered, until every worker has exited normally.
+		std::vector<pid_t> pids(workers);
+		for (long worker = 0; worker < workers; worker++) {
+			pids[worker] = forkworker((int)worker, workercpus[worker % workercpus.size()].first, workernodes[worker],
+				memsize, nodes, jobs, *shared);
+		}
+		while (std::any_of(pids.begin(), pids.end(), [](pid_t pid) { return pid > 0; })) {
+			int status;
+			const pid_t pid = waitpid(-1, &status, 0);
+			if (pid < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				break;
+			}
+			const long worker = std::find(pids.begin(), pids.end(), pid) - pids.begin();
+			if (worker == workers) {
+				continue;
+			}
+			pids[worker] = -1;
+			if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+				continue;
+			}
+			if (WIFSIGNALED(status)) {
+				fprintf(stderr, "Worker %ld crashed with signal %d and is restarted.\n", worker, WTERMSIG(status));
+			} else {
+				fprintf(stderr, "Worker %ld exited with status %d and is restarted.\n", worker, WEXITSTATUS(status));
+			}
+			recoverjobs((int)worker, jobs, *shared);
+			pids[worker] = forkworker((int)worker, workercpus[worker % workercpus.size()].first, workernodes[worker],
+				memsize, nodes, jobs, *shared);
+		}
+	}
+#endif
+
+	// A job which is not done was taken by a worker which crashed before recording it.
+	size_t failedjobs = 0;
+	for (const batchjob &job : jobs) {
+		if (job.state->phase != JOB_DONE || job.state->result != 0) {
+			failedjobs++;
+		}
+	}
+	fprintf(stderr, "Operation complete. %u of %u jobs failed.\n", (unsigned)failedjobs, (unsigned)jobs.size());
+
+	return failedjobs == 0 ? 0 : 1;
+
+}
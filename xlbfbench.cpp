@@ -0,0 +1,188 @@
+// The benchmark application which runs a brainfuck program under nested levels of a self-interpreter written in brainfuck, and reports the time and the steps of each level.
+// Self-interpretation is dominated by short instructions, unpredictable branches and scan loops, the patterns which real programs hit at a smaller scale, hence the time of each level is a sensitive canary for regressions in the dispatch and the scans of the interpreter.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "xlbrainfuck.h"
+
+
+
+// The self-interpreter dbfi by Daniel B Cristofani, which reads a program from its input up to a '!' and runs it on the rest of the input.
+// Nesting it runs a copy of itself, which in turn reads the program to run, so that level n reads n - 1 copies of itself followed by the program.
+const char *SELF_INTERPRETER =
+	">>>+[[-]>>[-]++>+>+++++++[<++++>>++<-]++>>+>+>+++++[>++>++++++<<-]+>>>,<++[[>["
+	"->>]<[>>]<<-]<[<]<+>>[>]>[<+>-[[<+>-]>]<[[[-]<]++<-[<+++++++++>[<->-]>>]>>]]<<"
+	"]<]<[[<]>[[>]>>[>>]+[<<]<[<]<+>>-]>[>]+[->>]<<<<[[<<]<[<]+<<[+>+<<-[>-->+<<-[>"
+	"+<[>>+<<-]]]>[<+>-]<]++>>-->[>]>>[>>]]<<[>>+<[[<]<]>[[<<]<[<]+[-<+>>-[<<+>++>-"
+	"[<->[<<+>>-]]]<[>+<-]>]>[>]>]>[>>]>>]<<[>>+>>+>>]<<[->>>>>>>>]<<[>.>>>>>>>]<<["
+	">->>>>>]<<[>,>>>]<<[>+>]<<[+<<]<]";
+
+// The deepest level of self-interpretation, as each level slows the program down by two to three orders of magnitude.
+constexpr int MAX_LEVELS = 3;
+
+
+
+// The input and output of a level being run.
+struct benchio {
+	const std::string *input;
+	size_t inputpos;
+	std::string *output;
+};
+
+void writebench(void *context, const char *data, size_t size) {
+	((benchio *)context)->output->append(data, size);
+}
+
+// Reads 0 at the end of the input, which the self-interpreter passes on to the program it runs.
+int readbench(void *context) {
+	benchio *io = (benchio *)context;
+	return io->inputpos < io->input->size() ? (unsigned char)(*io->input)[io->inputpos++] : 0;
+}
+
+// The result of a level: the status and the output of its execution, the best time of its timed executions, and the steps of its counted execution.
+struct benchresult {
+	int status;
+	std::string output;
+	double seconds;
+	unsigned long long steps;
+};
+
+// Keeps only the eight commands of the code, as the self-interpreter ends the code at the first '!' and does not know the ':' command.
+std::string stripcode(const char *code) {
+	std::string stripped;
+	for (const char *codeptr = code; *codeptr != 0; codeptr++) {
+		if (strchr("+-<>[],.", *codeptr) != nullptr) {
+			stripped += *codeptr;
+		}
+	}
+	return stripped;
+}
+
+// Runs the program on the input on a fresh tape, timing the best of the given number of executions.
+// The steps are counted in a separate execution under a step quota that is never reached and without memoization, which would skip the steps of memoized loops, so that neither the counting nor the skipping affects the timed executions.
+benchresult runlevel(const xl_brainfuck_program &program, size_t memsize, const std::string &input, int repeat) {
+	benchresult result = { STATUS_OK, std::string(), 0, 0 };
+	for (int run = 0; run <= repeat; run++) {
+		const bool iscounting = run == repeat;
+		xl_brainfuck_env<int> bfe(memsize);
+		std::string output;
+		benchio io = { &input, 0, &output };
+		bfe.setio({ writebench, readbench, &io });
+		bfe.setreporting(false);
+		if (iscounting) {
+			xl_brainfuck_quota quota = xl_brainfuck_quota();
+			quota.steps = ~0ull >> 1;
+			bfe.setquota(quota);
+			bfe.setmemoization(false);
+		}
+		const auto start = std::chrono::steady_clock::now();
+		const int status = bfe.execute(program);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (iscounting) {
+			result.steps = bfe.getusage().steps;
+		} else {
+			result.seconds = run == 0 ? seconds : std::min(result.seconds, seconds);
+			result.status = status;
+			result.output = std::move(output);
+		}
+	}
+	return result;
+}
+
+
+
+// Execution in command line: xlbfbench memsize bfsrc [input] [-levels n] [-repeat n]
+// Runs the brainfuck source file directly as level 0, and under 1 to n levels of the self-interpreter, where n defaults to 2 and is at most 3, with the content of the input file, if given, as the input of the program.
+// Each level is timed as the best of the given number of executions, 1 by default, and its steps, the trips of loops, are counted in one more execution. The output of every level must match that of level 0.
+int main(int argc, char **argv) {
+
+	// Ensures that the correct number of arguments has been passed, and reads the options.
+	const char *inputpath = nullptr;
+	int levels = 2;
+	int repeat = 1;
+	bool isvalid = argc >= 3;
+	for (int i = 3; i < argc && isvalid; i++) {
+		if (strcmp(argv[i], "-levels") == 0 && i + 1 < argc) {
+			levels = atoi(argv[++i]);
+			isvalid = levels >= 1 && levels <= MAX_LEVELS;
+		} else if (strcmp(argv[i], "-repeat") == 0 && i + 1 < argc) {
+			repeat = atoi(argv[++i]);
+			isvalid = repeat >= 1;
+		} else if (argv[i][0] != '-' && inputpath == nullptr) {
+			inputpath = argv[i];
+		} else {
+			isvalid = false;
+		}
+	}
+	if (!isvalid) {
+		fprintf(stderr, "You must specify the size of memory allocated to the brainfuck environment and the brainfuck source file.\n");
+		fprintf(stderr, "Follow this format in command line: xlbfbench memsize bfsrc [input] [-levels n] [-repeat n], where n is at most %d levels.\n", MAX_LEVELS);
+		return 1;
+	}
+	const long memsize = strtol(argv[1], nullptr, 10);
+	if (memsize <= 0) {
+		fprintf(stderr, "You must supply a valid positive integer for the size of memory allocated.\n");
+		return 1;
+	}
+
+	// Reads the source file and the input file.
+	std::string files[2];
+	const char *paths[2] = { argv[2], inputpath };
+	for (int i = 0; i < 2 && paths[i] != nullptr; i++) {
+		FILE *fp = fopen(paths[i], "rb");
+		if (fp == nullptr) {
+			fprintf(stderr, i == 0 ? "Invalid brainfuck source file.\n" : "Invalid input file.\n");
+			return 1;
+		}
+		char buffer[4096];
+		size_t size = 0;
+		while ((size = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+			files[i].append(buffer, size);
+		}
+		fclose(fp);
+	}
+
+	// Level 0 runs the program on its input, and each further level runs the self-interpreter on the input of the level below, preceded by the code that the level below runs and a '!'.
+	xl_brainfuck_program target;
+	target.compile(files[0].c_str());
+	xl_brainfuck_program interpreter;
+	interpreter.compile(SELF_INTERPRETER);
+	const std::string targetcode = stripcode(files[0].c_str());
+	std::string input = files[1];
+	benchresult baseline;
+	benchresult previous;
+	int result = 0;
+	for (int level = 0; level <= levels; level++) {
+		if (level > 0) {
+			input = (level == 1 ? targetcode : std::string(SELF_INTERPRETER)) + '!' + input;
+		}
+		const benchresult current = runlevel(level == 0 ? target : interpreter, (size_t)memsize, input, repeat);
+		printf("Level %d: %.3f seconds, %llu steps", level, current.seconds, current.steps);
+		if (level > 0) {
+			printf(", %.1fx the time and %.1fx the steps of level %d", previous.seconds > 0 ? current.seconds / previous.seconds : 0.0,
+				previous.steps > 0 ? (double)current.steps / previous.steps : 0.0, level - 1);
+		}
+		printf(".\n");
+		if (current.status != STATUS_OK) {
+			printf("Level %d ended with status %d.\n", level, current.status);
+			result = 1;
+			break;
+		}
+		if (level == 0) {
+			baseline = current;
+		} else if (current.output != baseline.output) {
+			printf("Level %d produced %u bytes of output which differ from level 0.\n", level, (unsigned)current.output.size());
+			result = 1;
+			break;
+		}
+		previous = current;
+		fflush(stdout);
+	}
+
+	return result;
+
+}
@@ -2,7 +2,9 @@
 
 #include <stdio.h>
 #include <string.h>
+#if defined(_WIN32)
 #include "conio.h"
+#endif
 #include "xlbrainfuck.h"
 
 
@@ -15,6 +17,75 @@ constexpr size_t VIEW_END_INDEX = 15;
 
 
 
+// Describes the position of the timeline and the cells in view, with the pointer marked.
+void printposition(xl_brainfuck_env<int> &bfe, const xl_brainfuck_program &program, xl_brainfuck_timeline<int> &timeline) {
+	const xl_brainfuck_state<int> state = bfe.getstate();
+	if (timeline.getstatus() == STATUS_PAUSED) {
+		printf("DEBUG: Paused at step %llu, before offset %u.\n", timeline.position(), (unsigned)program.sourceoffset(state.bytecodeoffset));
+	} else {
+		printf("DEBUG: Ended at step %llu with status %d.\n", timeline.position(), timeline.getstatus());
+	}
+	printf("CELLS:");
+	for (size_t index = VIEW_START_INDEX; index <= VIEW_END_INDEX && index < state.tapesize; index++) {
+		printf(index == state.ptroffset ? " [%d]" : " %d", state.tape[index]);
+	}
+	printf("\n");
+}
+
+// Runs the program under a timeline, which moves back and forth in the execution on the commands entered until quit is entered.
+void debug(xl_brainfuck_env<int> &bfe, const char *code) {
+	char linebuffer[LINE_BUFFER_SIZE + 1] = { 0 };
+	xl_brainfuck_program program;
+	program.compile(code);
+	xl_brainfuck_timeline<int> timeline(bfe, program, { writestdout, readconsole, nullptr });
+	printf("DEBUG: Enter run, step n, back n, change k, break n, unbreak n, watch k, unwatch k or quit. Steps count the trips of loops, n is a source offset in break and unbreak, and k is a cell.\n");
+	printposition(bfe, program, timeline);
+	while (true) {
+		printf("DEBUG ");
+		if (fgets(linebuffer, LINE_BUFFER_SIZE, stdin) == nullptr || strcmp(linebuffer, "quit\n") == 0) {
+			break;
+		}
+		unsigned long long count = 0;
+		if (strcmp(linebuffer, "run\n") == 0) {
+			timeline.forward(0);
+		} else if (sscanf(linebuffer, "step %llu", &count) == 1) {
+			timeline.forward(count);
+		} else if (sscanf(linebuffer, "back %llu", &count) == 1) {
+			timeline.backward(count);
+		} else if (sscanf(linebuffer, "change %llu", &count) == 1) {
+			if (!timeline.backtochange((size_t)count)) {
+				printf("DEBUG: The cell has not changed before this step.\n");
+			}
+		} else if (sscanf(linebuffer, "break %llu", &count) == 1) {
+			const size_t sourceoffset = program.setbreakpoint((size_t)count);
+			if (sourceoffset == (size_t)-1) {
+				printf("DEBUG: No instruction at or after this offset.\n");
+			} else {
+				printf("DEBUG: Breakpoint set at offset %u.\n", (unsigned)sourceoffset);
+			}
+			continue;
+		} else if (sscanf(linebuffer, "unbreak %llu", &count) == 1) {
+			if (!program.clearbreakpoint((size_t)count)) {
+				printf("DEBUG: No breakpoint at this offset.\n");
+			}
+			continue;
+		} else if (sscanf(linebuffer, "watch %llu", &count) == 1 || sscanf(linebuffer, "unwatch %llu", &count) == 1) {
+			if (!bfe.setwatchpoint((size_t)count, linebuffer[0] == 'w')) {
+				printf("DEBUG: The cell lies beyond the tape.\n");
+			}
+			continue;
+		} else {
+			printf("DEBUG: Unknown command.\n");
+			continue;
+		}
+		printf("\n");
+		printposition(bfe, program, timeline);
+	}
+	bfe.clearwatchpoints();
+}
+
+
+
 int main() {
 
 	char codebuffer[CODE_BUFFER_SIZE + 1] = { 0 };
@@ -25,6 +96,7 @@ int main() {
 
 	printf("== XL BRAINFUCK CONSOLE ==\n");
 	printf("# Enter reset to reinitialize the brainfuck environment.\n");
+	printf("# Enter debug to toggle the debugger, which can step back and forth in the execution of each code block.\n");
 	printf("# Other inputs will be interpreted as brainfuck code.\n");
 
 	while (true) {
@@ -40,6 +112,11 @@ int main() {
 				printf("CONSOLE: Environment reset.\n");
 				break;
 			}
+			if (strcmp(linebuffer, "debug\n") == 0) {
+				isdebug = !isdebug;
+				printf(isdebug ? "CONSOLE: Debugger enabled.\n" : "CONSOLE: Debugger disabled.\n");
+				break;
+			}
 			strncpy(codeptr, linebuffer, codebuffer + CODE_BUFFER_SIZE - codeptr);
 			while (*codeptr != 0) codeptr++;
 			if (strcmp(linebuffer, "\n") == 0 || codeptr >= codebuffer + CODE_BUFFER_SIZE) {
@@ -49,10 +126,14 @@ int main() {
 			memset(linebuffer, 0, sizeof(char) * (LINE_BUFFER_SIZE + 1));
 		}
 
-		// Interprets the code.
-		printf("OUTPUT: ");
-		bfe.interpret(codebuffer);
-		printf("\n");
+		// Interprets the code, or debugs it.
+		if (isdebug && codebuffer[0] != 0) {
+			debug(bfe, codebuffer);
+		} else {
+			printf("OUTPUT: ");
+			bfe.interpret(codebuffer);
+			printf("\n");
+		}
 
 		// Resets the code buffer and its ptr.
 		memset(codebuffer, 0, sizeof(char) * (CODE_BUFFER_SIZE + 1));
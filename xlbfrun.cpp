@@ -0,0 +1,668 @@
+// The runner application which interprets a file of brainfuck source code with the console as input and output.
+// A copy of the runner may also carry a compiled program bundled by the translator, which it runs in place of a source file.
+// A long execution may save checkpoints into a memory-mapped state file, from which a new process resumes it after a crash or a restart.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <memory>
+#include <vector>
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "xlbrainfuck.h"
+
+
+
+// The size of the pages in which the tape is compared and copied into the checkpoint file, and to which its parts are aligned.
+constexpr size_t CHECKPOINT_PAGE_SIZE = 4096;
+
+// The flags of a page of the tape whose writes are tracked: the slots of the checkpoint file which are stale for the page, and whether the page has been made writable since the latest checkpoint.
+constexpr unsigned char PAGE_STALE_SLOTS = 3;
+constexpr unsigned char PAGE_WRITABLE = 4;
+
+
+
+// The state of an execution in a slot of the checkpoint file, see xl_brainfuck_state.
+// The generation numbers the checkpoints, where zero marks a slot without any, and the checksum covers the other fields, so that a slot whose state was torn by a crash is ignored.
+struct checkpointstate {
+	unsigned long long generation;
+	unsigned long long ptroffset;
+	unsigned long long bytecodeoffset;
+	unsigned long long steps;
+	unsigned long long inputbytes;
+	unsigned long long outputbytes;
+	double seconds;
+	unsigned long long checksum;
+};
+
+// The header of a checkpoint file, which identifies the tape and the program of the execution and holds the states of its two slots.
+struct checkpointheader {
+	char magic[8];
+	unsigned long long cellsize;
+	unsigned long long tapesize;
+	unsigned long long programhash;
+	double interval;
+	checkpointstate states[2];
+};
+
+// The checkpoint file, which is mapped into memory and consists of the header page followed by a tape for each of the two slots.
+// Checkpoints alternate between the slots, so that the latest complete checkpoint survives a crash in the middle of the next one. A checkpoint copies only the pages of the tape which differ from its slot, synchronizes them to the disk, and then completes the slot by writing its state.
+// While the writes to the tape are tracked, the whole pages of the tape are write-protected after each checkpoint, and the first write to a page since then faults once, marks the page stale for both slots and makes it writable again. A checkpoint then only looks at the pages stale for its slot, so that its cost follows the pages written rather than the size of the tape, which matters most for a tape file larger than the memory. Without tracking, as on Windows, every page of the tape is compared against the slot.
+class checkpointfile {
+
+	char *mapping;
+	size_t mappingsize;
+	size_t slotsize;
+#if defined(_WIN32)
+	HANDLE file;
+	HANDLE filemapping;
+#else
+	int fd;
+
+	// The file whose tape is tracked, for the handler of the faults, and the handler which it replaced.
+	static checkpointfile *trackedfile;
+	static struct sigaction previousaction;
+#endif
+
+	// The whole pages of the tape which are write-protected while tracked, their size, the offset of the first from the start of the tape, and their flags.
+	char *protectstart;
+	size_t protectbytes;
+	size_t pagesize;
+	size_t protectoffset;
+	std::vector<unsigned char> pageflags;
+
+	// Hashes the fields of the state before the checksum.
+	static unsigned long long checksum(const checkpointstate &state) {
+		unsigned long long hash = 14695981039346656037ull;
+		const unsigned char *byteptr = (const unsigned char *)&state;
+		for (size_t i = 0; i < offsetof(checkpointstate, checksum); i++) {
+			hash = (hash ^ byteptr[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Writes the range of the mapping through to the disk.
+	void sync(const char *start, size_t size) {
+#if defined(_WIN32)
+		FlushViewOfFile(start, size);
+		FlushFileBuffers(this->file);
+#else
+		msync((void *)start, size, MS_SYNC);
+#endif
+	}
+
+	// Returns whether the page of CHECKPOINT_PAGE_SIZE bytes at the offset of the tape may differ from the slot, which is so unless the page is tracked and not stale for the slot.
+	bool isstale(size_t offset, size_t pagebytes, int slot) const {
+		if (offset < this->protectoffset || offset + pagebytes > this->protectoffset + this->protectbytes) {
+			return true;
+		}
+		return (this->pageflags[(offset - this->protectoffset) / this->pagesize] & (1 << slot)) != 0;
+	}
+
+	// Marks the pages of the tape as current in the slots, and write-protects the pages which were made writable since the latest checkpoint, in runs of adjacent pages.
+	void protect(unsigned char currentslots) {
+		size_t runstart = 0;
+		bool isinrun = false;
+		for (size_t page = 0; page <= this->pageflags.size(); page++) {
+			const bool iswritable = page < this->pageflags.size() && (this->pageflags[page] & PAGE_WRITABLE) != 0;
+			if (page < this->pageflags.size()) {
+				this->pageflags[page] &= (unsigned char)~(currentslots | PAGE_WRITABLE);
+			}
+			if (iswritable && !isinrun) {
+				runstart = page;
+				isinrun = true;
+			} else if (!iswritable && isinrun) {
+#if !defined(_WIN32)
+				mprotect(this->protectstart + runstart * this->pagesize, (page - runstart) * this->pagesize, PROT_READ);
+#endif
+				isinrun = false;
+			}
+		}
+	}
+
+#if !defined(_WIN32)
+	// Makes a write-protected page of the tracked tape writable again and marks it stale for both slots, or falls back to the previous handler for any other fault, which then recurs.
+	static void onfault(int, siginfo_t *info, void *) {
+		checkpointfile *file = trackedfile;
+		char *address = (char *)info->si_addr;
+		if (file == nullptr || address < file->protectstart || address >= file->protectstart + file->protectbytes) {
+			sigaction(SIGSEGV, &previousaction, nullptr);
+			return;
+		}
+		const size_t page = (size_t)(address - file->protectstart) / file->pagesize;
+		file->pageflags[page] = PAGE_STALE_SLOTS | PAGE_WRITABLE;
+		mprotect(file->protectstart + page * file->pagesize, file->pagesize, PROT_READ | PROT_WRITE);
+	}
+#endif
+
+public:
+
+	// The output channel to drain before each checkpoint, if the output is asynchronous.
+	xl_brainfuck_asyncoutput *asyncoutput;
+
+	checkpointfile() : mapping(nullptr), mappingsize(0), slotsize(0), protectstart(nullptr), protectbytes(0), pagesize(0), protectoffset(0), asyncoutput(nullptr) {
+#if defined(_WIN32)
+		this->file = INVALID_HANDLE_VALUE;
+		this->filemapping = nullptr;
+#else
+		this->fd = -1;
+#endif
+	}
+
+	~checkpointfile() {
+		this->untrack();
+		this->close();
+	}
+
+	// Starts tracking the writes to the tape of the execution whose checkpoints are saved into the file, from the state in which the tape is current in the slots which are not stale.
+	// The pages of a fresh execution are current in both slots, as the tape and the slots start out as zeros, while those of a resumed execution are only current in the slot it resumed from.
+	// Returns false if the writes cannot be tracked, in which case every checkpoint compares the whole tape.
+	bool track(const int *tape, size_t tapesize, unsigned char staleslots) {
+#if defined(_WIN32)
+		return false;
+#else
+		const long systempagesize = sysconf(_SC_PAGESIZE);
+		if (systempagesize <= 0 || (size_t)systempagesize % CHECKPOINT_PAGE_SIZE != 0 || trackedfile != nullptr) {
+			return false;
+		}
+		this->pagesize = (size_t)systempagesize;
+		const uintptr_t start = ((uintptr_t)tape + this->pagesize - 1) / this->pagesize * this->pagesize;
+		const uintptr_t end = ((uintptr_t)tape + tapesize * sizeof(int)) / this->pagesize * this->pagesize;
+		if (end <= start) {
+			return false;
+		}
+		this->protectstart = (char *)start;
+		this->protectbytes = (size_t)(end - start);
+		this->protectoffset = (size_t)(start - (uintptr_t)tape);
+		this->pageflags.assign(this->protectbytes / this->pagesize, (unsigned char)(staleslots | PAGE_WRITABLE));
+
+		struct sigaction action;
+		memset(&action, 0, sizeof(action));
+		action.sa_sigaction = checkpointfile::onfault;
+		action.sa_flags = SA_SIGINFO;
+		sigemptyset(&action.sa_mask);
+		trackedfile = this;
+		if (sigaction(SIGSEGV, &action, &previousaction) != 0) {
+			trackedfile = nullptr;
+			this->protectbytes = 0;
+			this->pageflags.clear();
+			return false;
+		}
+		this->protect(0);
+		return true;
+#endif
+	}
+
+	// Stops tracking the writes to the tape, leaving all its pages writable.
+	void untrack() {
+#if !defined(_WIN32)
+		if (trackedfile == this) {
+			mprotect(this->protectstart, this->protectbytes, PROT_READ | PROT_WRITE);
+			sigaction(SIGSEGV, &previousaction, nullptr);
+			trackedfile = nullptr;
+		}
+#endif
+		this->protectbytes = 0;
+		this->pageflags.clear();
+	}
+
+	// Creates the file for the checkpoints of an execution with the tape and program, or opens the existing file to resume from it, and maps it into memory.
+	// Returns false if the file cannot be created or opened, or if an existing file belongs to another tape or program.
+	bool open(const char *path, bool create, size_t tapesize, unsigned long long programhash, double interval) {
+		this->slotsize = (tapesize * sizeof(int) + CHECKPOINT_PAGE_SIZE - 1) / CHECKPOINT_PAGE_SIZE * CHECKPOINT_PAGE_SIZE;
+		const size_t filesize = CHECKPOINT_PAGE_SIZE + 2 * this->slotsize;
+#if defined(_WIN32)
+		this->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (this->file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER size;
+		if (create) {
+			size.QuadPart = (LONGLONG)filesize;
+			if (!SetFilePointerEx(this->file, size, nullptr, FILE_BEGIN) || !SetEndOfFile(this->file)) {
+				return false;
+			}
+		} else if (!GetFileSizeEx(this->file, &size) || (size_t)size.QuadPart != filesize) {
+			return false;
+		}
+		this->filemapping = CreateFileMappingA(this->file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+		if (this->filemapping == nullptr) {
+			return false;
+		}
+		this->mapping = (char *)MapViewOfFile(this->filemapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+		if (this->mapping == nullptr) {
+			return false;
+		}
+#else
+		this->fd = ::open(path, create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0644);
+		if (this->fd < 0) {
+			return false;
+		}
+		struct stat filestat;
+		if (create ? ftruncate(this->fd, (off_t)filesize) != 0 : fstat(this->fd, &filestat) != 0 || (size_t)filestat.st_size != filesize) {
+			return false;
+		}
+		void *mapping = mmap(nullptr, filesize, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+		if (mapping == MAP_FAILED) {
+			return false;
+		}
+		this->mapping = (char *)mapping;
+#endif
+		this->mappingsize = filesize;
+
+		checkpointheader &header = *(checkpointheader *)this->mapping;
+		if (create) {
+			memcpy(header.magic, "XLBFCKPT", sizeof(header.magic));
+			header.cellsize = sizeof(int);
+			header.tapesize = tapesize;
+			header.programhash = programhash;
+			header.interval = interval;
+			this->sync(this->mapping, CHECKPOINT_PAGE_SIZE);
+			return true;
+		}
+		return memcmp(header.magic, "XLBFCKPT", sizeof(header.magic)) == 0 && header.cellsize == sizeof(int) &&
+			header.tapesize == tapesize && header.programhash == programhash;
+	}
+
+	// Unmaps and closes the file.
+	void close() {
+#if defined(_WIN32)
+		if (this->mapping != nullptr) {
+			UnmapViewOfFile(this->mapping);
+		}
+		if (this->filemapping != nullptr) {
+			CloseHandle(this->filemapping);
+		}
+		if (this->file != INVALID_HANDLE_VALUE) {
+			CloseHandle(this->file);
+		}
+		this->filemapping = nullptr;
+		this->file = INVALID_HANDLE_VALUE;
+#else
+		if (this->mapping != nullptr) {
+			munmap(this->mapping, this->mappingsize);
+		}
+		if (this->fd >= 0) {
+			::close(this->fd);
+		}
+		this->fd = -1;
+#endif
+		this->mapping = nullptr;
+	}
+
+	// Returns the interval between checkpoints which the file was created with.
+	double interval() const {
+		return ((const checkpointheader *)this->mapping)->interval;
+	}
+
+	// Returns the slot of the latest complete checkpoint, or -1 if there is none.
+	int latest() const {
+		const checkpointheader &header = *(const checkpointheader *)this->mapping;
+		int latestslot = -1;
+		for (int slot = 0; slot < 2; slot++) {
+			const checkpointstate &state = header.states[slot];
+			if (state.generation != 0 && state.checksum == checksum(state) &&
+				(latestslot < 0 || state.generation > header.states[latestslot].generation)) {
+				latestslot = slot;
+			}
+		}
+		return latestslot;
+	}
+
+	// Returns the state of the execution at the checkpoint in the slot, whose tape lies within the mapping.
+	xl_brainfuck_state<int> load(int slot) const {
+		const checkpointstate &state = ((const checkpointheader *)this->mapping)->states[slot];
+		xl_brainfuck_usage usage = xl_brainfuck_usage();
+		usage.steps = state.steps;
+		usage.outputbytes = (size_t)state.outputbytes;
+		usage.seconds = state.seconds;
+		usage.inputbytes = (size_t)state.inputbytes;
+		return { (const int *)(this->mapping + CHECKPOINT_PAGE_SIZE + slot * this->slotsize),
+			(size_t)((const checkpointheader *)this->mapping)->tapesize, (size_t)state.ptroffset, (size_t)state.bytecodeoffset, usage };
+	}
+
+	// Saves the state of an execution into the older slot, as the save function of a checkpointer whose context is the file.
+	// The output written so far is first synchronized to the disk, so that the output file is never shorter than the checkpoint accounts for.
+	static void save(void *context, const xl_brainfuck_state<int> &state) {
+		checkpointfile &file = *(checkpointfile *)context;
+		if (file.asyncoutput != nullptr) {
+			file.asyncoutput->flush();
+		}
+		fflush(stdout);
+#if defined(_WIN32)
+		_commit(_fileno(stdout));
+#else
+		fsync(fileno(stdout));
+#endif
+		checkpointheader &header = *(checkpointheader *)file.mapping;
+		const int latestslot = file.latest();
+		const int slot = latestslot < 0 ? 0 : 1 - latestslot;
+		char *slottape = file.mapping + CHECKPOINT_PAGE_SIZE + slot * file.slotsize;
+		const char *tape = (const char *)state.tape;
+		const size_t tapebytes = state.tapesize * sizeof(int);
+		for (size_t offset = 0; offset < tapebytes; offset += CHECKPOINT_PAGE_SIZE) {
+			const size_t pagebytes = std::min(CHECKPOINT_PAGE_SIZE, tapebytes - offset);
+			if (file.isstale(offset, pagebytes, slot) && memcmp(slottape + offset, tape + offset, pagebytes) != 0) {
+				memcpy(slottape + offset, tape + offset, pagebytes);
+			}
+		}
+		file.protect((unsigned char)(1 << slot));
+		file.sync(slottape, file.slotsize);
+
+		checkpointstate &slotstate = header.states[slot];
+		slotstate.generation = latestslot < 0 ? 1 : header.states[latestslot].generation + 1;
+		slotstate.ptroffset = state.ptroffset;
+		slotstate.bytecodeoffset = state.bytecodeoffset;
+		slotstate.steps = state.usage.steps;
+		slotstate.inputbytes = state.usage.inputbytes;
+		slotstate.outputbytes = state.usage.outputbytes;
+		slotstate.seconds = state.usage.seconds;
+		slotstate.checksum = checksum(slotstate);
+		file.sync(file.mapping, CHECKPOINT_PAGE_SIZE);
+	}
+
+};
+
+#if !defined(_WIN32)
+checkpointfile *checkpointfile::trackedfile = nullptr;
+struct sigaction checkpointfile::previousaction;
+#endif
+
+// Loads the program which the translator bundled into this executable, reading its trailer and serialized form straight from the executable mapped into memory, so that only their pages are read from the disk.
+// Returns 1 if the executable carries a valid program, with the memory size it was bundled with, 0 if it carries none, and -1 if its program is invalid.
+int loadbundle(const char *argv0, xl_brainfuck_program &program, long &memsize) {
+	int result = 0;
+	const unsigned char *mapping = nullptr;
+	size_t mappingsize = 0;
+#if defined(_WIN32)
+	char path[MAX_PATH + 1] = { 0 };
+	if (GetModuleFileNameA(nullptr, path, MAX_PATH) == 0) {
+		return 0;
+	}
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return 0;
+	}
+	LARGE_INTEGER size;
+	HANDLE filemapping = nullptr;
+	if (GetFileSizeEx(file, &size) && (size_t)size.QuadPart >= sizeof(xl_brainfuck_bundletrailer)) {
+		filemapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (filemapping != nullptr) {
+			mapping = (const unsigned char *)MapViewOfFile(filemapping, FILE_MAP_READ, 0, 0, 0);
+			mappingsize = (size_t)size.QuadPart;
+		}
+	}
+#else
+	int fd = open("/proc/self/exe", O_RDONLY);
+	if (fd < 0) {
+		fd = open(argv0, O_RDONLY);
+	}
+	if (fd < 0) {
+		return 0;
+	}
+	struct stat filestat;
+	if (fstat(fd, &filestat) == 0 && (size_t)filestat.st_size >= sizeof(xl_brainfuck_bundletrailer)) {
+		void *filemapping = mmap(nullptr, (size_t)filestat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (filemapping != MAP_FAILED) {
+			mapping = (const unsigned char *)filemapping;
+			mappingsize = (size_t)filestat.st_size;
+		}
+	}
+#endif
+
+	if (mapping != nullptr) {
+		xl_brainfuck_bundletrailer trailer;
+		memcpy(&trailer, mapping + mappingsize - sizeof(trailer), sizeof(trailer));
+		if (memcmp(trailer.magic, "XLBFBNDL", sizeof(trailer.magic)) == 0) {
+			result = -1;
+			if (trailer.programsize <= mappingsize - sizeof(trailer) && trailer.memsize > 0 && trailer.memsize <= (unsigned long long)LONG_MAX &&
+				program.deserialize(mapping + mappingsize - sizeof(trailer) - trailer.programsize, (size_t)trailer.programsize) &&
+				program.hash() == trailer.programhash) {
+				memsize = (long)trailer.memsize;
+				result = 1;
+			}
+		}
+	}
+
+#if defined(_WIN32)
+	if (mapping != nullptr) {
+		UnmapViewOfFile(mapping);
+	}
+	if (filemapping != nullptr) {
+		CloseHandle(filemapping);
+	}
+	CloseHandle(file);
+#else
+	if (mapping != nullptr) {
+		munmap((void *)mapping, mappingsize);
+	}
+	close(fd);
+#endif
+	return result;
+}
+
+// Moves the standard input and output to where the execution stood at the checkpoint.
+// The input read before the checkpoint is skipped, by seeking in a file or by reading past it in the input given again through a pipe, and the output written after the checkpoint is truncated from an output file, as it is written again.
+void resumeio(const xl_brainfuck_usage &usage) {
+	if (fseek(stdin, (long)usage.inputbytes, SEEK_SET) != 0) {
+		for (size_t i = 0; i < usage.inputbytes && getchar() != EOF; i++) {
+		}
+	}
+	if (fseek(stdout, 0, SEEK_END) == 0 && ftell(stdout) >= (long)usage.outputbytes) {
+#if defined(_WIN32)
+		_chsize_s(_fileno(stdout), (long long)usage.outputbytes);
+#else
+		if (ftruncate(fileno(stdout), (off_t)usage.outputbytes) != 0) {
+			fprintf(stderr, "Unable to truncate the output written after the checkpoint.\n");
+		}
+#endif
+		fseek(stdout, (long)usage.outputbytes, SEEK_SET);
+	}
+}
+
+
+
+// Execution in command line: xlbfrun memsize bfsrc [-profile profile | -optimize profile] [-async] [-checkpoint statefile seconds | -resume statefile] [-tapefile tapefile [-keeptape]] [-circular] [-bidirectional]
+// A bundled executable, which the translator builds from a copy of the runner and a compiled program, runs its program on the memory size it was bundled with and takes only the -async, -checkpoint, -resume, -tapefile, -keeptape, -circular and -bidirectional options.
+// With memsize auto, the tape is sized to exactly the cells which the code is proved to reach on either side of its start, and the code runs without bounds checks.
+// With -profile, the execution is profiled and the profile is saved into the file, from which the translator and the -optimize option can optimize the code.
+// With -optimize, the code is compiled with the speculative specializations drawn from the profile in the file.
+// With -async, the output is written by a separate thread, so that the execution does not wait for a slow terminal, pipe or file.
+// With -tapefile, the tape is backed by a sparse file rather than by memory, so that it may be larger than the physical memory, and with -keeptape, the file is kept with the final tape once the execution ends.
+// With -circular, the pointer wraps around the ends of the tape rather than leaving it, for which memsize must be a power of two.
+// With -bidirectional, memsize cells are reserved on each side of the start of the pointer, so that the code may move left of its start, and only the pages touched on either side of a large tape take memory.
+// With -checkpoint, the state of the execution is saved into the state file every given number of seconds, and with -resume, the execution continues from the latest checkpoint in the state file and keeps saving checkpoints into it. The same memory size, source file and optimization must be given to resume, and the state file is removed once the execution ends.
+int main(int argc, char **argv) {
+
+	// Loads the bundled program, if any.
+	xl_brainfuck_program program;
+	long memsize = 0;
+	const int bundle = loadbundle(argv[0], program, memsize);
+	if (bundle < 0) {
+		fprintf(stderr, "The program bundled into the executable is invalid.\n");
+		return 1;
+	}
+	const bool isbundled = bundle > 0;
+
+	// Ensures that the correct number of arguments has been passed, and reads the options.
+	const char *profilepath = nullptr;
+	bool isprofiling = false;
+	bool isoptimizing = false;
+	bool isasync = false;
+	const char *statepath = nullptr;
+	bool isresuming = false;
+	double interval = 0;
+	const char *tapepath = nullptr;
+	bool keeptape = false;
+	bool iscircular = false;
+	bool isbidirectional = false;
+	bool isvalid = isbundled || argc >= 3;
+	for (int i = isbundled ? 1 : 3; i < argc && isvalid; i++) {
+		if ((strcmp(argv[i], "-profile") == 0 || strcmp(argv[i], "-optimize") == 0) && i + 1 < argc && profilepath == nullptr) {
+			isprofiling = strcmp(argv[i], "-profile") == 0;
+			isoptimizing = !isprofiling;
+			profilepath = argv[++i];
+		} else if (strcmp(argv[i], "-async") == 0) {
+			isasync = true;
+		} else if (strcmp(argv[i], "-checkpoint") == 0 && i + 2 < argc && statepath == nullptr) {
+			statepath = argv[++i];
+			interval = strtod(argv[++i], nullptr);
+			isvalid = interval > 0;
+		} else if (strcmp(argv[i], "-resume") == 0 && i + 1 < argc && statepath == nullptr) {
+			statepath = argv[++i];
+			isresuming = true;
+		} else if (strcmp(argv[i], "-tapefile") == 0 && i + 1 < argc && tapepath == nullptr) {
+			tapepath = argv[++i];
+		} else if (strcmp(argv[i], "-keeptape") == 0) {
+			keeptape = true;
+		} else if (strcmp(argv[i], "-circular") == 0) {
+			iscircular = true;
+		} else if (strcmp(argv[i], "-bidirectional") == 0) {
+			isbidirectional = true;
+		} else {
+			isvalid = false;
+		}
+	}
+	// Profiling is not resumable, hence it excludes checkpoints, and a bundled program has already been compiled.
+	isvalid = isvalid && (!keeptape || tapepath != nullptr);
+	if (isbundled && (!isvalid || profilepath != nullptr)) {
+		fprintf(stderr, "Follow this format in command line: %s [-async] [-checkpoint statefile seconds | -resume statefile] [-tapefile tapefile [-keeptape]] [-circular] [-bidirectional].\n", argv[0]);
+		return 1;
+	}
+	if (!isvalid || (isprofiling && statepath != nullptr)) {
+		fprintf(stderr, "You must specify the size of memory allocated to the brainfuck environment and the brainfuck source file.\n");
+		fprintf(stderr, "Follow this format in command line: xlbfrun memsize bfsrc [-profile profile | -optimize profile] [-async] [-checkpoint statefile seconds | -resume statefile] [-tapefile tapefile [-keeptape]] [-circular] [-bidirectional].\n");
+		return 1;
+	}
+
+	// Processes the arguments and determines if they are valid, and compiles the source code unless the program is bundled.
+	const bool isautosize = !isbundled && strcmp(argv[1], "auto") == 0;
+	char *bfcodebuffer = nullptr;
+	xl_brainfuck_profile profile;
+	if (!isbundled) {
+		memsize = isautosize ? 1 : strtol(argv[1], nullptr, 10);
+		if (memsize <= 0) {
+			fprintf(stderr, "You must supply a valid positive integer or auto for the size of memory allocated.\n");
+			return 1;
+		}
+		const char *bfsrc = argv[2];
+		FILE *bfsrcfp = fopen(bfsrc, "rb");
+		if (bfsrcfp == nullptr) {
+			fprintf(stderr, "Invalid brainfuck source file.\n");
+			return 1;
+		}
+
+		// Copies file content into a buffer.
+		fseek(bfsrcfp, 0, SEEK_END);
+		size_t filesize = ftell(bfsrcfp);
+		rewind(bfsrcfp);
+		bfcodebuffer = (char *)calloc(filesize + 1, sizeof(char));
+		fread(bfcodebuffer, 1, filesize, bfsrcfp);
+		fclose(bfsrcfp);
+
+		if (isoptimizing && profile.load(profilepath) != 0) {
+			fprintf(stderr, "Invalid profile file.\n");
+			return 1;
+		}
+
+		program.compile(bfcodebuffer, isoptimizing ? &profile : nullptr);
+	}
+
+	// Sizes the tape from the range of the pointer, whose origin is as far from the first cell as the pointer may move left of its start.
+	size_t tapesize = isbidirectional ? (size_t)memsize * 2 : (size_t)memsize;
+	size_t origin = isbidirectional ? (size_t)memsize : 0;
+	if (isautosize) {
+		ptrdiff_t minoffset = 0;
+		ptrdiff_t maxoffset = 0;
+		if (!program.bounds(&minoffset, &maxoffset)) {
+			fprintf(stderr, "The range of the pointer cannot be proved to fit a tape, hence the size of memory must be supplied.\n");
+			return 1;
+		}
+		origin = (size_t)-std::min<ptrdiff_t>(minoffset, 0);
+		tapesize = origin + (size_t)std::max<ptrdiff_t>(maxoffset, 0) + 1;
+	}
+
+	xl_brainfuck_env<int> bfe(tapesize, tapepath, keeptape);
+	bfe.setorigin(origin);
+	if (!bfe.isready()) {
+		fprintf(stderr, tapepath != nullptr ? "Unable to create and map the tape file.\n" : "Unable to allocate the tape.\n");
+		return 1;
+	}
+	if (iscircular && !bfe.setcircular(true)) {
+		fprintf(stderr, "The size of memory must be a power of two of at least two cells for the tape to be circular.\n");
+		return 1;
+	}
+	if (isprofiling) {
+		bfe.setprofile(&profile);
+	}
+
+	// Opens the state file, and restores the latest checkpoint and the position of the input and output to resume from.
+	checkpointfile statefile;
+	size_t bytecodeoffset = 0;
+	unsigned char staleslots = 0;
+	if (statepath != nullptr) {
+		if (!statefile.open(statepath, !isresuming, tapesize, program.hash(), interval)) {
+			fprintf(stderr, isresuming ?
+				"Invalid state file, or the state file does not match the memory size, source file and optimization.\n" :
+				"Unable to create state file.\n");
+			return 1;
+		}
+		if (isresuming) {
+			const int slot = statefile.latest();
+			staleslots = slot < 0 ? PAGE_STALE_SLOTS : (unsigned char)(1 << (1 - slot));
+			if (slot >= 0) {
+				const xl_brainfuck_state<int> state = statefile.load(slot);
+				if (!bfe.restore(state) || state.bytecodeoffset >= program.size()) {
+					fprintf(stderr, "Invalid state file.\n");
+					return 1;
+				}
+				resumeio(state.usage);
+				bytecodeoffset = state.bytecodeoffset;
+			}
+			interval = statefile.interval();
+		}
+		bfe.setcheckpointer({ checkpointfile::save, &statefile, interval });
+	}
+
+	std::unique_ptr<xl_brainfuck_asyncoutput> asyncoutput;
+	if (isasync) {
+		asyncoutput.reset(new xl_brainfuck_asyncoutput(fileno(stdout)));
+		bfe.setio(asyncoutput->io());
+		statefile.asyncoutput = asyncoutput.get();
+	}
+	// Tracks the pages written between checkpoints, once the tape has been restored.
+	if (statepath != nullptr) {
+		const xl_brainfuck_state<int> state = bfe.getstate();
+		statefile.track(state.tape, state.tapesize, staleslots);
+	}
+	const int result = bfe.execute(program, bytecodeoffset);
+	statefile.untrack();
+	fflush(stdout);
+	// Waits for the writer thread to write the rest of the output.
+	asyncoutput.reset();
+
+	// Removes the state file, as the execution has ended.
+	if (statepath != nullptr) {
+		statefile.close();
+		remove(statepath);
+	}
+
+	// Saves the profile of the execution.
+	if (isprofiling && profile.save(profilepath) != 0) {
+		fprintf(stderr, "Unable to write profile file.\n");
+	}
+
+	free(bfcodebuffer);
+
+	return result;
+
+}
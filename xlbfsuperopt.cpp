@@ -0,0 +1,422 @@
+// The superoptimizer application which searches for cheaper brainfuck code equivalent to the loops found most often in a corpus of brainfuck source files.
+// Every sequence of commands up to a given length is enumerated on all cores, and a candidate is accepted if its bytecode is smaller than that of the loop and it leaves the tape in the same state as the loop on every test. The tests run both on random tapes through the interpreter, and on every combination of byte values of the cells of the loop when the loop touches few enough cells, and each test runs on cells of every width supported by the environments, since a loop which relies on the wrapping of its cells may only be equivalent to the candidate on one width.
+// The rules found hold on cells of every width, and are written to the standard output, one per line, as the number of sites of the loop in the corpus, the loop and its replacement.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include "xlbrainfuck.h"
+
+
+
+// Loops longer than MAX_FRAGMENT_LENGTH commands are not mined, and only the FRAGMENT_COUNT loops with the most commands over all their sites are searched.
+constexpr size_t MAX_FRAGMENT_LENGTH = 32;
+constexpr size_t FRAGMENT_COUNT = 64;
+
+// The tests run on a tape of TEST_TAPE_SIZE cells with the pointer starting in its middle, and compare the cells within TEST_WINDOW cells of the pointer after the code has run.
+// The code runs for at most TEST_STEP_LIMIT loop trips, and a test on which either code exceeds the limit proves nothing about the state it would leave, so the candidate is rejected.
+constexpr size_t TEST_TAPE_SIZE = 256;
+constexpr size_t TEST_WINDOW = 96;
+constexpr unsigned long long TEST_STEP_LIMIT = 4096;
+
+// A candidate is first tested on QUICK_TESTS random tapes, which rejects almost all candidates, and then on RANDOM_TESTS random tapes.
+// If the loop touches at most EXHAUSTIVE_MAX_CELLS cells, the candidate is also tested on every combination of values of those cells.
+constexpr size_t QUICK_TESTS = 8;
+constexpr size_t RANDOM_TESTS = 1024;
+constexpr ptrdiff_t EXHAUSTIVE_MAX_CELLS = 2;
+
+// The candidates are enumerated in chunks of CANDIDATE_CHUNK, which the threads take in turn.
+constexpr unsigned long long CANDIDATE_CHUNK = 4096;
+
+// The commands from which the candidates are composed.
+const char CANDIDATE_COMMANDS[] = "+-<>[]";
+constexpr unsigned long long CANDIDATE_RADIX = 6;
+
+
+
+// A loop mined from the corpus, with the number of its sites and the size of its bytecode.
+struct fragment {
+	std::string commands;
+	size_t sites;
+	size_t cost;
+};
+
+// The best replacement of a fragment found by a thread, if any.
+struct replacement {
+	std::string commands;
+	size_t cost;
+};
+
+
+
+// Reads the whole content of a file into the buffer, and returns false if the file cannot be read.
+bool readfile(const char *path, std::string &buffer) {
+	FILE *fp = fopen(path, "rb");
+	if (fp == nullptr) {
+		return false;
+	}
+	buffer.clear();
+	char chunk[4096];
+	size_t chunksize;
+	while ((chunksize = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+		buffer.append(chunk, chunksize);
+	}
+	fclose(fp);
+	return true;
+}
+
+// Returns the size of the bytecode of the code, which is the cost minimized by the search.
+size_t codecost(const std::string &commands) {
+	xl_brainfuck_program program;
+	program.compile(commands.c_str());
+	return program.size();
+}
+
+// Counts the loops of the code which are free of I/O and no longer than MAX_FRAGMENT_LENGTH commands, keyed by their commands.
+void minefragments(const std::string &code, std::map<std::string, size_t> &sitecounts) {
+	std::string commands;
+	for (char command : code) {
+		if (strchr("+-<>.,[]", command) != nullptr && command != 0) {
+			commands.push_back(command);
+		}
+	}
+	std::vector<size_t> openstack;
+	for (size_t i = 0; i < commands.size(); i++) {
+		if (commands[i] == '[') {
+			openstack.push_back(i);
+		} else if (commands[i] == ']' && !openstack.empty()) {
+			const std::string loop = commands.substr(openstack.back(), i - openstack.back() + 1);
+			openstack.pop_back();
+			if (loop.size() <= MAX_FRAGMENT_LENGTH && loop.find_first_of(".,") == std::string::npos) {
+				sitecounts[loop]++;
+			}
+		}
+	}
+}
+
+// Writes the code of the candidate with the index among the candidates of the length, and returns false if the candidate is never cheaper than a shorter one.
+// Candidates with unbalanced or empty loops, or with adjacent commands which cancel out, are skipped.
+bool candidatecommands(size_t length, unsigned long long index, std::string &commands) {
+	commands.resize(length);
+	int depth = 0;
+	for (size_t i = 0; i < length; i++) {
+		const char command = CANDIDATE_COMMANDS[index % CANDIDATE_RADIX];
+		index /= CANDIDATE_RADIX;
+		commands[i] = command;
+		depth += command == '[' ? 1 : command == ']' ? -1 : 0;
+		if (depth < 0) {
+			return false;
+		}
+		if (i > 0) {
+			const char previous = commands[i - 1];
+			if ((previous == '+' && command == '-') || (previous == '-' && command == '+') ||
+				(previous == '<' && command == '>') || (previous == '>' && command == '<') ||
+				(previous == '[' && command == ']')) {
+				return false;
+			}
+		}
+	}
+	return depth == 0;
+}
+
+// Compiles the code which sets the cells of the tape to the values and moves the pointer to the middle of the tape.
+void compilestate(const std::vector<unsigned char> &cells, xl_brainfuck_program &program) {
+	std::string code;
+	for (unsigned char cell : cells) {
+		code.append(cell, '+');
+		code.push_back('>');
+	}
+	code.append(TEST_TAPE_SIZE - TEST_TAPE_SIZE / 2, '<');
+	program.compile(code.c_str());
+}
+
+// Fills the cells with random values, which are mostly zero or small so that the loops under test take both directions.
+void randomcells(std::mt19937 &generator, std::vector<unsigned char> &cells) {
+	cells.resize(TEST_TAPE_SIZE);
+	for (unsigned char &cell : cells) {
+		const unsigned kind = generator() % 4;
+		cell = kind <= 1 ? 0 : kind == 2 ? (unsigned char)(1 + generator() % 3) : (unsigned char)generator();
+	}
+}
+
+
+
+// The tester of a thread for cells of one width, which runs code under test on its own brainfuck environment and observes the resulting state.
+template<typename storage_t>
+class tester {
+
+	xl_brainfuck_env<storage_t> bfe;
+
+public:
+
+	tester() : bfe(TEST_TAPE_SIZE) {
+		this->bfe.setreporting(false);
+		this->bfe.setmemoization(false);
+	}
+
+	// Runs the code from the state, and writes the pointer and the cells around it afterwards, or the status of the error which ended the code, into the observation.
+	// Returns false if the code exceeded the step limit, in which case the state it would leave is unknown.
+	bool observe(const xl_brainfuck_program &state, const xl_brainfuck_program &code, std::string &observation) {
+		this->bfe.reset();
+		this->bfe.execute(state);
+		this->bfe.setquota({ TEST_STEP_LIMIT, 0, 0, 0 });
+		const int status = this->bfe.execute(code);
+		if (status == STATUS_STEP_QUOTA) {
+			return false;
+		}
+		if (status != STATUS_OK) {
+			observation = "status " + std::to_string(status);
+			return true;
+		}
+		// The cells are read from the tape rather than written as output, which would only keep the low byte of wider cells.
+		const xl_brainfuck_state<storage_t> result = this->bfe.getstate();
+		const size_t windowstart = result.ptroffset >= TEST_WINDOW ? result.ptroffset - TEST_WINDOW : 0;
+		const size_t windowend = std::min(result.tapesize, result.ptroffset + TEST_WINDOW + 1);
+		observation = "pointer " + std::to_string(result.ptroffset) + " cells ";
+		observation.append((const char *)(result.tape + windowstart), (windowend - windowstart) * sizeof(storage_t));
+		return true;
+	}
+
+};
+
+// The testers of a thread for the CELL_WIDTH_COUNT cell widths supported by the environments, of 1, 2, 4 and 8 bytes in that order.
+constexpr size_t CELL_WIDTH_COUNT = 4;
+
+struct testers {
+	tester<unsigned char> width1;
+	tester<unsigned short> width2;
+	tester<unsigned> width4;
+	tester<unsigned long long> width8;
+};
+
+
+
+// The tests of a fragment, with the states observed after the fragment ran on each test on each cell width.
+struct fragmenttests {
+	const fragment *target;
+	std::vector<xl_brainfuck_program> states;
+	std::vector<std::string> expected[CELL_WIDTH_COUNT];
+	ptrdiff_t windowmin;
+	ptrdiff_t windowmax;
+	bool isexhaustive;
+	std::vector<unsigned char> background;
+};
+
+// Determines if the candidate leaves the same state as the fragment on every test on the cells of the tester, where the quick tests come first.
+// A test on which the candidate or the fragment exceeds the step limit rejects the candidate, as it cannot be shown to be equivalent.
+template<typename storage_t>
+bool isequivalentonwidth(const fragmenttests &tests, const std::vector<std::string> &expected, const xl_brainfuck_program &candidate,
+	tester<storage_t> &candidatetester, tester<storage_t> &fragmenttester) {
+
+	std::string observation;
+	for (size_t i = 0; i < tests.states.size(); i++) {
+		if (!candidatetester.observe(tests.states[i], candidate, observation) || observation != expected[i]) {
+			return false;
+		}
+	}
+	if (!tests.isexhaustive) {
+		return true;
+	}
+	// Tests every combination of byte values of the cells touched by the fragment on a random background.
+	xl_brainfuck_program fragmentprogram;
+	fragmentprogram.compile(tests.target->commands.c_str());
+	const size_t cellcount = (size_t)(tests.windowmax - tests.windowmin + 1);
+	std::vector<unsigned char> cells = tests.background;
+	xl_brainfuck_program state;
+	std::string fragmentobservation;
+	for (unsigned long long combination = 0; combination < (1ull << (8 * cellcount)); combination++) {
+		for (size_t i = 0; i < cellcount; i++) {
+			cells[TEST_TAPE_SIZE / 2 + tests.windowmin + i] = (unsigned char)(combination >> (8 * i));
+		}
+		compilestate(cells, state);
+		if (!candidatetester.observe(state, candidate, observation) || !fragmenttester.observe(state, fragmentprogram, fragmentobservation) ||
+			observation != fragmentobservation) {
+			return false;
+		}
+	}
+	return true;
+
+}
+
+// Determines if the candidate leaves the same state as the fragment on every test on every cell width, where the narrowest cells, on which wrapping is most frequent, come first.
+bool isequivalent(const fragmenttests &tests, const xl_brainfuck_program &candidate, testers &candidatetesters, testers &fragmenttesters) {
+	return isequivalentonwidth(tests, tests.expected[0], candidate, candidatetesters.width1, fragmenttesters.width1) &&
+		isequivalentonwidth(tests, tests.expected[1], candidate, candidatetesters.width2, fragmenttesters.width2) &&
+		isequivalentonwidth(tests, tests.expected[2], candidate, candidatetesters.width4, fragmenttesters.width4) &&
+		isequivalentonwidth(tests, tests.expected[3], candidate, candidatetesters.width8, fragmenttesters.width8);
+}
+
+// Observes the fragment on every test on the cells of the tester, and returns false if it exceeds the step limit on any test, in which case no candidate can be shown to be equivalent.
+template<typename storage_t>
+bool observefragment(const std::vector<xl_brainfuck_program> &states, const xl_brainfuck_program &fragmentprogram,
+	tester<storage_t> &fragmenttester, std::vector<std::string> &expected) {
+
+	expected.resize(states.size());
+	for (size_t i = 0; i < states.size(); i++) {
+		if (!fragmenttester.observe(states[i], fragmentprogram, expected[i])) {
+			return false;
+		}
+	}
+	return true;
+
+}
+
+// Enumerates the candidates taken from the shared counter, which lengthstarts bounds to the maximum length, and keeps the cheapest one equivalent to the fragment.
+void searchworker(const fragmenttests &tests, std::atomic<unsigned long long> &nextchunk,
+	const std::vector<unsigned long long> &lengthstarts, replacement &best) {
+
+	testers candidatetesters;
+	testers fragmenttesters;
+	xl_brainfuck_program candidate;
+	std::string commands;
+	const unsigned long long candidatecount = lengthstarts.back();
+
+	while (true) {
+		const unsigned long long chunkstart = nextchunk.fetch_add(CANDIDATE_CHUNK, std::memory_order_relaxed);
+		if (chunkstart >= candidatecount) {
+			break;
+		}
+		const unsigned long long chunkend = std::min(candidatecount, chunkstart + CANDIDATE_CHUNK);
+		for (unsigned long long position = chunkstart; position < chunkend; position++) {
+			const size_t length = (size_t)(std::upper_bound(lengthstarts.begin(), lengthstarts.end(), position) - lengthstarts.begin());
+			if (!candidatecommands(length, position - lengthstarts[length - 1], commands)) {
+				continue;
+			}
+			candidate.compile(commands.c_str());
+			const size_t cost = candidate.size();
+			if (cost > tests.target->cost || (cost == tests.target->cost && length >= tests.target->commands.size()) ||
+				(!best.commands.empty() && (cost > best.cost || (cost == best.cost && length >= best.commands.size())))) {
+				continue;
+			}
+			if (isequivalent(tests, candidate, candidatetesters, fragmenttesters)) {
+				best = { commands, cost };
+			}
+		}
+	}
+
+}
+
+// Searches all the candidates up to the maximum length for the cheapest replacement of the fragment on the threads, and returns false if none is found.
+bool searchfragment(const fragment &target, const std::vector<xl_brainfuck_program> &states,
+	const std::vector<unsigned char> &background, size_t maxlength, unsigned threadcount, replacement &found) {
+
+	fragmenttests tests;
+	tests.target = &target;
+	tests.background = background;
+	xl_brainfuck_program fragmentprogram;
+	fragmentprogram.compile(target.commands.c_str());
+	tests.states = states;
+	testers fragmenttesters;
+	if (!observefragment(states, fragmentprogram, fragmenttesters.width1, tests.expected[0]) ||
+		!observefragment(states, fragmentprogram, fragmenttesters.width2, tests.expected[1]) ||
+		!observefragment(states, fragmentprogram, fragmenttesters.width4, tests.expected[2]) ||
+		!observefragment(states, fragmentprogram, fragmenttesters.width8, tests.expected[3])) {
+		return false;
+	}
+	tests.isexhaustive = fragmentprogram.bounds(&tests.windowmin, &tests.windowmax) &&
+		tests.windowmax - tests.windowmin < EXHAUSTIVE_MAX_CELLS;
+
+	// Numbers the candidates of all lengths consecutively, where the candidates of length n start at lengthstarts[n - 1].
+	std::vector<unsigned long long> lengthstarts(1, 0);
+	unsigned long long lengthcount = 1;
+	for (size_t length = 1; length <= std::min(maxlength, target.commands.size()); length++) {
+		lengthcount *= CANDIDATE_RADIX;
+		lengthstarts.push_back(lengthstarts.back() + lengthcount);
+	}
+
+	std::atomic<unsigned long long> nextchunk(0);
+	std::vector<replacement> bests(threadcount);
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i < threadcount; i++) {
+		threads.emplace_back(searchworker, std::cref(tests), std::ref(nextchunk), std::cref(lengthstarts), std::ref(bests[i]));
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+
+	found = replacement();
+	for (const replacement &best : bests) {
+		if (!best.commands.empty() && (found.commands.empty() || best.cost < found.cost ||
+			(best.cost == found.cost && best.commands.size() < found.commands.size()))) {
+			found = best;
+		}
+	}
+	return !found.commands.empty();
+}
+
+
+
+// Execution in command line: xlbfsuperopt maxlength bfsrc [bfsrc ...]
+// The candidates of up to maxlength commands are searched for each of the most frequent loops of the source files.
+int main(int argc, char **argv) {
+
+	// Ensures that the correct number of arguments has been passed.
+	if (argc < 3) {
+		fprintf(stderr, "You must specify the maximum length of the candidates and the brainfuck source files of the corpus.\n");
+		fprintf(stderr, "Follow this format in command line: xlbfsuperopt maxlength bfsrc [bfsrc ...].\n");
+		return 1;
+	}
+
+	// Processes the arguments and determines if they are valid.
+	const long maxlength = strtol(argv[1], nullptr, 10);
+	if (maxlength <= 0) {
+		fprintf(stderr, "You must supply a valid positive integer for the maximum length of the candidates.\n");
+		return 1;
+	}
+
+	// Mines the loops of the corpus, and orders them by the number of commands over all their sites.
+	std::map<std::string, size_t> sitecounts;
+	std::string code;
+	for (int i = 2; i < argc; i++) {
+		if (!readfile(argv[i], code)) {
+			fprintf(stderr, "Unable to read brainfuck source file %s.\n", argv[i]);
+			return 1;
+		}
+		minefragments(code, sitecounts);
+	}
+	std::vector<fragment> fragments;
+	for (const auto &sitecount : sitecounts) {
+		fragments.push_back({ sitecount.first, sitecount.second, codecost(sitecount.first) });
+	}
+	std::stable_sort(fragments.begin(), fragments.end(), [](const fragment &a, const fragment &b) {
+		return a.sites * a.commands.size() > b.sites * b.commands.size();
+	});
+	if (fragments.size() > FRAGMENT_COUNT) {
+		fragments.resize(FRAGMENT_COUNT);
+	}
+
+	// Draws the random tapes shared by all the fragments.
+	std::mt19937 generator(2166136261u);
+	std::vector<unsigned char> cells;
+	std::vector<xl_brainfuck_program> states(QUICK_TESTS + RANDOM_TESTS);
+	for (xl_brainfuck_program &state : states) {
+		randomcells(generator, cells);
+		compilestate(cells, state);
+	}
+	std::vector<unsigned char> background;
+	randomcells(generator, background);
+
+	const unsigned threadcount = std::max(1u, std::thread::hardware_concurrency());
+	fprintf(stderr, "Searching %u loops for replacements of up to %ld commands on %u threads ...\n",
+		(unsigned)fragments.size(), maxlength, threadcount);
+
+	size_t rules = 0;
+	for (const fragment &target : fragments) {
+		replacement found;
+		if (searchfragment(target, states, background, (size_t)maxlength, threadcount, found)) {
+			printf("%u %s %s\n", (unsigned)target.sites, target.commands.c_str(), found.commands.c_str());
+			fflush(stdout);
+			rules++;
+		}
+	}
+	fprintf(stderr, "Operation complete. %u rules found for %u loops.\n", (unsigned)rules, (unsigned)fragments.size());
+
+	return 0;
+
+}
@@ -1,17 +1,86 @@
-// The translator application which translates a block of brainfuck code into C code.
+// The translator application which translates a block of brainfuck code into C code, or bundles its bytecode into a copy of the runner.
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#endif
 #include "xlbrainfuck.h"
 
 
 
-// Execution in command line: xlbftranslator memsize bfsrc cdest
+// Writes a bundled executable into the file: a copy of the runner, stripped of any program bundled into it before, followed by the serialized program and the trailer through which the runner finds it.
+// Returns false if the runner cannot be read or the executable cannot be written.
+bool writebundle(FILE *destfp, const char *runnerpath, const xl_brainfuck_program &program, long memsize) {
+	FILE *runnerfp = fopen(runnerpath, "rb");
+	if (runnerfp == nullptr) {
+		return false;
+	}
+	fseek(runnerfp, 0, SEEK_END);
+	std::vector<unsigned char> runner((size_t)ftell(runnerfp));
+	rewind(runnerfp);
+	const bool isread = fread(runner.data(), 1, runner.size(), runnerfp) == runner.size();
+	fclose(runnerfp);
+	if (!isread) {
+		return false;
+	}
+
+	xl_brainfuck_bundletrailer trailer;
+	size_t runnersize = runner.size();
+	if (runnersize >= sizeof(trailer)) {
+		memcpy(&trailer, runner.data() + runnersize - sizeof(trailer), sizeof(trailer));
+		if (memcmp(trailer.magic, "XLBFBNDL", sizeof(trailer.magic)) == 0 && trailer.programsize <= runnersize - sizeof(trailer)) {
+			runnersize -= sizeof(trailer) + (size_t)trailer.programsize;
+		}
+	}
+
+	std::vector<unsigned char> payload;
+	program.serialize(payload);
+	trailer.programsize = payload.size();
+	trailer.memsize = (unsigned long long)memsize;
+	trailer.programhash = program.hash();
+	memcpy(trailer.magic, "XLBFBNDL", sizeof(trailer.magic));
+	if (fwrite(runner.data(), 1, runnersize, destfp) != runnersize || fwrite(payload.data(), 1, payload.size(), destfp) != payload.size() ||
+		fwrite(&trailer, 1, sizeof(trailer), destfp) != sizeof(trailer)) {
+		return false;
+	}
+#if !defined(_WIN32)
+	fchmod(fileno(destfp), 0755);
+#endif
+	return true;
+}
+
+
+
+// Execution in command line: xlbftranslator memsize bfsrc cdest [profile] [-bundle runner] [-circular] [-bidirectional]
+// If a profile file saved by the runner is given, the translation is optimized for the profiled executions.
+// With -bundle, no C code is generated: the code is compiled into bytecode, optimized by the profile if given, and appended to a copy of the runner, the xlbfrun executable, so that the destination is an executable which runs the code on memsize cells without any compiler.
+// With -circular, the C code wraps the index of the tape around its ends, for which memsize must be a power of two. A bundled executable is made circular by the -circular option when it is run.
+// With -bidirectional, the C code reserves memsize cells on each side of the start of the index, so that the code may move left of its start. A bundled executable takes the same option when it is run.
 int main(int argc, char **argv) {
 	
-	// Ensures that the correct number of arguments has been passed.
-	if (argc != 4) {
+	// Ensures that the correct number of arguments has been passed, and reads the profile and the runner.
+	const char *profilepath = nullptr;
+	const char *runnerpath = nullptr;
+	bool iscircular = false;
+	bool isbidirectional = false;
+	bool isvalid = argc >= 4;
+	for (int i = 4; i < argc && isvalid; i++) {
+		if (strcmp(argv[i], "-bundle") == 0 && i + 1 < argc && runnerpath == nullptr) {
+			runnerpath = argv[++i];
+		} else if (strcmp(argv[i], "-circular") == 0) {
+			iscircular = true;
+		} else if (strcmp(argv[i], "-bidirectional") == 0) {
+			isbidirectional = true;
+		} else if (argv[i][0] != '-' && profilepath == nullptr) {
+			profilepath = argv[i];
+		} else {
+			isvalid = false;
+		}
+	}
+	if (!isvalid) {
 		fprintf(stderr, "You must specify the size of memory allocated to the brainfuck environment, the brainfuck source file, and the C destination file.\n");
-		fprintf(stderr, "Follow this format in command line: xlbftranslator memsize bfsrc cdest.\n");
+		fprintf(stderr, "Follow this format in command line: xlbftranslator memsize bfsrc cdest [profile] [-bundle runner] [-circular] [-bidirectional].\n");
 		return 1;
 	}
 
@@ -32,7 +101,19 @@ int main(int argc, char **argv) {
 		fprintf(stderr, "Unable to create C destination file.\n");
 	}
 
-	xl_brainfuck_env<int> bfe(memsize);
+	xl_brainfuck_env<int> bfe(isbidirectional ? (size_t)memsize * 2 : (size_t)memsize);
+	bfe.setorigin(isbidirectional ? (size_t)memsize : 0);
+	if (iscircular && !bfe.setcircular(true)) {
+		fprintf(stderr, "The size of memory must be a power of two of at least two cells for the tape to be circular.\n");
+		return 1;
+	}
+
+	// Loads the profile, if any.
+	xl_brainfuck_profile profile;
+	if (profilepath != nullptr && profile.load(profilepath) != 0) {
+		fprintf(stderr, "Invalid profile file.\n");
+		return 1;
+	}
 
 	// Copies file content into a buffer.
 	fprintf(stderr, "Reading brainfuck source file ...\n");
@@ -44,21 +125,38 @@ int main(int argc, char **argv) {
 	fread(bfcodebuffer, 1, filesize, bfsrcfp);
 	fprintf(stderr, "Content read:\n%s\n", bfcodebuffer);
 
+	// Compiles the code into bytecode and bundles it with the runner.
+	if (runnerpath != nullptr) {
+		fprintf(stderr, "Bundling bytecode with runner %s ...\n", runnerpath);
+		xl_brainfuck_program program;
+		program.compile(bfcodebuffer, profilepath != nullptr ? &profile : nullptr);
+		const bool isbundled = writebundle(cdestfp, runnerpath, program, memsize);
+		fprintf(stderr, isbundled ? "Bytecode size: %u.\nOperation complete.\n" : "Unable to bundle the runner into the destination file.\n", (unsigned)program.size());
+		free(bfcodebuffer);
+		fclose(bfsrcfp);
+		fclose(cdestfp);
+		return isbundled ? 0 : 1;
+	}
+
 	// Translates brainfuck code into C code and stores the content.
-	size_t ccodesize = filesize * 32;
-	char *ccodebuffer = (char *)calloc(ccodesize + 1, sizeof(char));
+	std::string ccode;
 	fprintf(stderr, "Translating brainfuck code to C code ...\n");
-	bfe.translate(bfcodebuffer, ccodebuffer);
-	fprintf(stderr, "Translated C code:\n%s\n", ccodebuffer);
+	bfe.translate(bfcodebuffer, ccode, profilepath != nullptr ? &profile : nullptr);
+	fprintf(stderr, "Translated C code:\n%s\n", ccode.c_str());
+
+	// Reports the loops that were deduplicated into shared functions.
+	xl_brainfuck_translate_stats translatestats = bfe.gettranslatestats();
+	fprintf(stderr, "Shared loop sites: %u of %u, translated into %u functions (dedup ratio %.2f).\n",
+		(unsigned)translatestats.sharedsites, (unsigned)translatestats.loopsites, (unsigned)translatestats.sharedfunctions,
+		translatestats.sharedfunctions == 0 ? 1.0 : (double)translatestats.sharedsites / translatestats.sharedfunctions);
 
 	// Writes content to destination file.
 	fprintf(stderr, "Writing into C destination file ...\n");
-	fprintf(cdestfp, ccodebuffer);
+	fprintf(cdestfp, ccode.c_str());
 
 	fprintf(stderr, "Operation complete.\n");
 	// Frees up resources.
 	free(bfcodebuffer);
-	free(ccodebuffer);
 	fclose(bfsrcfp);
 	fclose(cdestfp);
 
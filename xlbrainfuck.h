@@ -6,517 +6,3103 @@ BRAINFUCK ENVIRONMENT:
 
 < Outline >
 # Instantiation of the xl_brainfuck_env class establishes a brainfuck environment with a conceptual tape with a predefined number of storage units and the type of storage, as well as a pointer that initially points to the start of the tape. To calculate large numbers, the class is implemented as a template where the user may specify any type of storage unit that passes the std::is_integral<storage_t> test.
-# The interpret method receives and interprets a block of code, which may or may not involve printing of the results onto the standard output. In the process, the internal states of the brainfuck environment such as the values on the tape and the location of pointer will be changed. To reinitialize the environment, the user must explicitly call the reset method, or subsequent calls of the interpret method will continue with the latest internal state.
-# The translate method receives a block of brainfuck code from the source buffer, translates it into the corresponding C code, and stores it in the target buffer.
+# The interpret method receives and interprets a block of code, which may or may not involve printing of the results onto the standard output. The code is first compiled into an xl_brainfuck_program, which the execute method then runs. In the process, the internal states of the brainfuck environment such as the values on the tape and the location of pointer will be changed. To reinitialize the environment, the user must explicitly call the reset method, or subsequent calls of the interpret method will continue with the latest internal state.
+# The translate method receives a block of brainfuck code from the source buffer, translates it into the corresponding C code, and stores it in the target string.
 
 < Implementations >
 # Code interpretation: interprets all the eight characters that define the brainfuck language. As per the language's specification, miscellaneous characters are simply ignored. Nonetheless, for more direct visualization of value, an additional ':' character is implemented to print the numerical value of the memory cell currently pointed to. For example, using "++++:" directly prints the result 4 whereas "++++." will print the character corresponding to ASCII code 4, which cannot be visualized.
 # Translation of brainfuck code into C code: allows the user to translate a string of brainfuck code into a string of C-code. In this case, the ':' character available in interpretation is not included because it is not part of the brainfuck language standard. Some optimizations are done to collate several increments and decrements as well as pointer movements into single statements.
+# Bytecode: the code is compiled into a dense bytecode of one-byte opcodes followed by varint operands only where needed, so that large programs stay within the caches. Consecutive increments and decrements as well as pointer movements are collated into single instructions, loops jump directly to their matching ends, and a side table maps each instruction back to its source offset for error messages.
+# Scan loops: loops such as "[>]" or "[<<]", which only move the pointer by a fixed stride until a zero cell is found, are executed as a single instruction without per-step bounds checks. The scan prefetches the cells ahead of the pointer in its direction, and prefetches them as non-temporal when the previous trip of the same scan exceeded the size of the last-level cache.
+# Profile-guided optimization: an execution may be recorded into an xl_brainfuck_profile, which holds the trip counts and branch directions of each loop and the range of values stored into the cells, and which is saved into a text file. The translation of the profiled code marks the loop conditions as likely or unlikely so that the C compiler lays out the hot paths first, and marks the loops which always ran the same small number of times for unrolling.
+# Pointer range inference: when every loop of the code is balanced, the cells which the pointer may reach are known at compile time as a range of offsets from the starting cell. If that range lies within the tape, the code is executed without any bounds checks, and a runner may size the tape to exactly that range.
+# Infinite loop detection: a loop which does no I/O, returns the pointer to where it started and never changes its cell is reported when it is entered, rather than left to spin forever. Optionally, the interpreter also reports any such loop whose window of cells returns to a state it has been in, by comparing the window periodically against a snapshot.
+# Resource quotas: an environment may limit the trips of loops, the pages of the tape, the bytes of output and the wall time of its executions, so that untrusted programs can be hosted side by side. The quotas are checked at the trips of loops and at I/O, and an execution which exceeds one ends with a status code describing the error, as does any other error.
+# Sparse tapes: a large tape is mapped from anonymous memory, so that all its pages start as the one zero page shared by the kernel and only the pages written are materialized. A program that uses a few clusters of cells far apart takes the memory of its clusters only, and resetting or restoring the tape hands the pages which become zero back to the kernel rather than writing zeros into them.
+# Circular tapes: a tape whose size is a power of two may be made circular for programs which assume a wrapping tape, in which case the pointer wraps around the ends of the tape by masking its offset rather than being checked against them. Code which is proved to stay within the tape runs without masks, and the translator folds the mask into the index of the tape.
+# Bidirectional tapes: the pointer may start at an origin within the tape rather than at its first cell, so that a program may move left of its start without padding its code. A large tape with its origin in the middle grows in both directions, as only the pages touched on either side of the origin take memory.
+# Tape files: a tape larger than the physical memory may be backed by a sparse file mapped into memory, of which only the pages written take space. The kernel is advised at the checks of the quotas to read the file sequentially and ahead of the pointer while the pointer keeps travelling in one direction, and the file may be kept as the final tape.
+# Checkpoints: a long execution may hand its state to a checkpointer at regular intervals, at the trips of loops where the quotas are checked, and the state may be restored into another environment to resume the execution from the same instruction. The caches of the memoization and the detection of infinite loops start afresh on resumption, as they only ever speed up or shorten the execution.
+# Time travel: an execution may be paused at the trip of a loop at which a given number of steps is reached, and resumed later. An xl_brainfuck_timeline builds on the pauses and the checkpoints to step an execution back and forth: it keeps periodic snapshots of the environment whose unchanged pages are shared, records the input, and moves back by restoring the latest snapshot before the target and replaying from there.
+# Breakpoints and watchpoints: a breakpoint patches the instruction at a source offset with a trap opcode that is dispatched like any other, so that a program without breakpoints runs its original bytecode, and a specialized loop whose body holds a breakpoint is trapped as a whole and falls back to the generic loop. Watchpoints on cells select a separate instantiation of the interpreter which checks each write, so that executions without watchpoints carry no checks at all. Either pauses the execution right at the instruction, and the timeline uses the watchpoints to find the exact instruction at which a cell last changed.
+# Bundled executables: a compiled program may be serialized and loaded again without its source code. The translator appends the serialized bytecode, optimized by a profile if one is given, to a copy of the runner, which maps its own executable on start and runs the program it finds at the end, so that a standalone executable is built in milliseconds without a C compiler.
+# Adaptive tiering: code that is executed many times, as in a service, may be held by an xl_brainfuck_adaptiveprogram, which chooses between the plain bytecode, profiled executions and the specialized bytecode by a cost model of the compilation time, the loops that could be specialized, the time spent in the executions so far and a profile if one is given. Specializations which turn out slower are reverted.
+# Speculative specialization: when the profile shows that a balanced loop without nested loops or input always ran the same small number of times, the loop is compiled into a specialized instruction which runs its body that many times without testing the condition. A guard checks before entering that the window of the loop lies within the tape and that the current cell reaches zero after exactly that many iterations; when the guard fails, the execution falls back to the generic loop with the state untouched.
+# Input and output: the output is buffered inside the environment and written to an output channel, and the input is read from an input channel. Both channels default to the console and may be replaced through the setio method. Error messages are written to the output channel after any pending output. For output-heavy executions, the xl_brainfuck_asyncoutput channel hands the output to a writer thread through a lock-free ring, so that the execution does not wait for a slow file descriptor unless the ring is full.
+# Loop memoization: loops that do no I/O and whose every nested loop returns the pointer to where it started only ever touch a small, statically known window of cells around the pointer. The result of such a loop is therefore a pure function of that window, and the interpreter caches the window on exit against the window on entry. The cache is kept per loop and abandoned once enough probes show that the hit rate does not pay for the lookups.
 
 < Exceptions >
-# Although no formal implementation for exceptions has been specified in the language standard, the following two error types will be thrown:
+# Although no formal implementation for exceptions has been specified in the language standard, the following error types will be thrown:
 	$ Syntax error: occurs when the counts of '[' and ']' do not match, indicating an unenclosed loop. This is the only syntax error possible for brainfuck as all other characters operate on themselves and miscellaneous characters are ignored.
 	$ Access violation: occurs when the pointer inside the environment attempts to read from or write into an address outside the environment's address boundaries.
+	$ Infinite loop: occurs when a loop is proved never to end, see the infinite loop detection above.
+	$ Quota exceeded: occurs when an execution exceeds one of the resource quotas of the environment.
+# Each error ends the execution with a status code, and its message is written to the output channel unless reporting is disabled.
 
 < Application >
-# The implementations in this header may interface with customized console or other applications.
-# For demonstration, a console program has been written which receives and interprets multiple lines from standard input, and displays any results into the standard output. In addition, a translator program has been written which will create translate a file of brainfuck source code into a c source file.
+# The implementations in this header may interface with customized console or other applications. The library libxlbf wraps them in a stable C interface, declared in xlbf.h, for programs in other languages to embed the environment in-process.
+# For demonstration, a console program has been written which receives and interprets multiple lines from standard input, and displays any results into the standard output. The console may also debug the code, stepping back and forth in its execution. In addition, a translator program has been written which will create translate a file of brainfuck source code into a c source file, or bundle its bytecode with the runner into a standalone executable. A runner program interprets a file of brainfuck source code and may save the profile of the execution for the translator. A batch runner program runs a list of brainfuck source files on their input files with a pool of worker threads placed on the NUMA nodes of the machine, and uses the input and output channels of the environment to keep the input and output of each job in memory. A superoptimizer program mines the most frequent loops of a corpus of brainfuck source files and searches all the cores for shorter code which the interpreter shows to be equivalent, and writes what it finds as rewrite rules. A benchmark program runs a file of brainfuck source code directly and under up to three nested levels of a self-interpreter written in brainfuck, and reports the time and the steps of each level as a canary for the performance of the dispatch and the scans.
 
 < Comments >
-# The header and the program rely on the <conio.h> for console input and output, which may not be supported by some systems.
+# The header and the program rely on the <conio.h> for console input and output, which may not be supported by some systems. On systems without it, the console input falls back to the standard input.
 # For translation, the default storage type of the brainfuck environment is assumed to be int.
 */
 
 #pragma once
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdarg.h>
 #include <string.h>
+#if defined(_WIN32)
 #include <conio.h>
+#endif
 #include <type_traits>
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <xmmintrin.h>
+#endif
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#endif
 
 
 
-// Moves a pointer to the end of the current str.
-// Used to concatenate multiple strings into the buffer.
-void gotoend(char **ptr) {
-	while (**ptr != 0) (*ptr)++;
+// Appends a string formatted as by printf to the end of str, which grows to fit it.
+// Used to concatenate the statements of the translated C code, whose length cannot be bounded by the length of the brainfuck code.
+#if defined(__GNUC__)
+__attribute__((format(printf, 2, 3)))
+#endif
+inline void appendformat(std::string &str, const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	va_list argscopy;
+	va_copy(argscopy, args);
+	const int length = vsnprintf(nullptr, 0, format, argscopy);
+	va_end(argscopy);
+	if (length > 0) {
+		const size_t start = str.size();
+		str.resize(start + (size_t)length + 1);
+		vsnprintf(&str[start], (size_t)length + 1, format, args);
+		str.resize(start + (size_t)length);
+	}
+	va_end(args);
 }
 
 
 
-// The xl_brainfuck_env class, where the template is provided to support multiple storage types.
+// Substitutes the unbuffered console input of <conio.h> with the standard input on systems which lack the header.
+#if !defined(_WIN32)
+inline int _getch() {
+	return getchar();
+}
+#endif
+
+
+
+// The input and output channels of a brainfuck environment.
+// The write function receives the output in chunks, and the read function returns the next input character or EOF at the end of the input, in which case the cell is left unchanged.
+struct xl_brainfuck_io {
+	void (*write)(void *context, const char *data, size_t size);
+	int (*read)(void *context);
+	void *context;
+};
+
+// The default channels, which write to the standard output and read from the console.
+inline void writestdout(void *, const char *data, size_t size) {
+	fwrite(data, 1, size, stdout);
+}
+inline int readconsole(void *) {
+	return _getch();
+}
+
+// The size of the output buffer of a brainfuck environment.
+constexpr size_t OUTPUT_BUFFER_SIZE = 4096;
+
+// The default size of the ring of an asynchronous output channel, which must be a power of two.
+constexpr size_t ASYNC_OUTPUT_RING_SIZE = 1 << 20;
+
+
+
+// The xl_brainfuck_asyncoutput class, an output channel which decouples the execution from a slow file descriptor such as a terminal, a pipe or a network file.
+// The environment pushes its output into a single-producer, single-consumer ring, which a dedicated writer thread drains into the file descriptor with a single writev per contiguous batch. The positions of the ring are lock-free, and either thread sleeps only when the ring is empty or full.
+// The output is drained when the channel is destroyed. Errors of the file descriptor drop the output rather than stall the execution.
+class xl_brainfuck_asyncoutput {
+
+	std::vector<char> ring;
+	size_t mask;
+	int fd;
+
+	// The positions where the producer writes next and the writer reads next, which only ever increase and are reduced by the mask to index the ring.
+	std::atomic<size_t> head;
+	std::atomic<size_t> tail;
+
+	// Whether a thread sleeps, and the mutex and condition on which it sleeps.
+	std::atomic<bool> writersleeping;
+	std::atomic<bool> producersleeping;
+	std::atomic<bool> closing;
+	std::mutex sleepmutex;
+	std::condition_variable writerwakeup;
+	std::condition_variable producerwakeup;
+
+	std::thread writer;
+
+public:
+
+	// Starts the writer thread for the file descriptor, with a ring of the size rounded up to a power of two.
+	xl_brainfuck_asyncoutput(int fd, size_t ringsize = ASYNC_OUTPUT_RING_SIZE) : fd(fd), head(0), tail(0),
+		writersleeping(false), producersleeping(false), closing(false) {
+		size_t capacity = 1;
+		while (capacity < ringsize) {
+			capacity <<= 1;
+		}
+		this->ring.resize(capacity);
+		this->mask = capacity - 1;
+		this->writer = std::thread(&xl_brainfuck_asyncoutput::drain, this);
+	}
+
+	// Drains the ring and stops the writer thread.
+	~xl_brainfuck_asyncoutput() {
+		{
+			std::lock_guard<std::mutex> lock(this->sleepmutex);
+			this->closing.store(true);
+		}
+		this->writerwakeup.notify_one();
+		this->writer.join();
+	}
+
+	// Returns the output channel which pushes into the ring, paired with the console input, which waits for the output to be written first so that any prompt is visible.
+	xl_brainfuck_io io() {
+		return { xl_brainfuck_asyncoutput::push, xl_brainfuck_asyncoutput::pull, this };
+	}
+
+	// Waits until the writer thread has written everything pushed so far.
+	void flush() {
+		std::unique_lock<std::mutex> lock(this->sleepmutex);
+		this->producersleeping.store(true);
+		this->producerwakeup.wait(lock, [this] { return this->tail.load() == this->head.load(); });
+		this->producersleeping.store(false);
+	}
+
+private:
+
+	// Copies the output into the ring, and waits for the writer thread only while the ring is full.
+	static void push(void *context, const char *data, size_t size) {
+		xl_brainfuck_asyncoutput *output = (xl_brainfuck_asyncoutput *)context;
+		const size_t capacity = output->ring.size();
+		size_t head = output->head.load(std::memory_order_relaxed);
+		while (size > 0) {
+			size_t space = capacity - (head - output->tail.load(std::memory_order_acquire));
+			if (space == 0) {
+				std::unique_lock<std::mutex> lock(output->sleepmutex);
+				output->producersleeping.store(true);
+				output->producerwakeup.wait(lock, [&] { return head - output->tail.load() < capacity; });
+				output->producersleeping.store(false);
+				continue;
+			}
+			// Copies up to the end of the ring at most, and wraps around in the next round.
+			const size_t offset = head & output->mask;
+			const size_t chunk = std::min(std::min(size, space), capacity - offset);
+			memcpy(output->ring.data() + offset, data, chunk);
+			data += chunk;
+			size -= chunk;
+			head += chunk;
+			output->head.store(head, std::memory_order_seq_cst);
+			if (output->writersleeping.load(std::memory_order_seq_cst)) {
+				std::lock_guard<std::mutex> lock(output->sleepmutex);
+				output->writerwakeup.notify_one();
+			}
+		}
+	}
+
+	static int pull(void *context) {
+		((xl_brainfuck_asyncoutput *)context)->flush();
+		return readconsole(nullptr);
+	}
+
+	// Writes the contents of the ring into the file descriptor until the channel is closed and the ring is empty.
+	// The contents may wrap around the end of the ring, in which case both parts are written by the same writev.
+	void drain() {
+		const size_t capacity = this->ring.size();
+		while (true) {
+			size_t tail = this->tail.load(std::memory_order_relaxed);
+			size_t head = this->head.load(std::memory_order_acquire);
+			if (head == tail) {
+				std::unique_lock<std::mutex> lock(this->sleepmutex);
+				this->writersleeping.store(true, std::memory_order_seq_cst);
+				this->writerwakeup.wait(lock, [&] { return this->head.load() != tail || this->closing.load(); });
+				this->writersleeping.store(false);
+				if (this->head.load() == tail) {
+					break;
+				}
+				continue;
+			}
+			const size_t offset = tail & this->mask;
+			const size_t firstsize = std::min(head - tail, capacity - offset);
+			const size_t written = this->writeparts(this->ring.data() + offset, firstsize,
+				this->ring.data(), head - tail - firstsize);
+			this->tail.store(tail + written, std::memory_order_seq_cst);
+			if (this->producersleeping.load(std::memory_order_seq_cst)) {
+				std::lock_guard<std::mutex> lock(this->sleepmutex);
+				this->producerwakeup.notify_one();
+			}
+		}
+	}
+
+	// Writes the two parts into the file descriptor, and returns the number of bytes consumed, which counts the bytes dropped on an error as written.
+	size_t writeparts(const char *first, size_t firstsize, const char *second, size_t secondsize) {
+#if defined(_WIN32)
+		const int written = _write(this->fd, first, (unsigned)firstsize);
+		if (written >= 0 && (size_t)written == firstsize && secondsize > 0) {
+			const int secondwritten = _write(this->fd, second, (unsigned)secondsize);
+			return firstsize + (secondwritten > 0 ? (size_t)secondwritten : secondsize);
+		}
+		return written > 0 ? (size_t)written : firstsize + secondsize;
+#else
+		struct iovec parts[2] = { { (void *)first, firstsize }, { (void *)second, secondsize } };
+		while (true) {
+			const ssize_t written = writev(this->fd, parts, secondsize > 0 ? 2 : 1);
+			if (written >= 0) {
+				return (size_t)written;
+			}
+			if (errno != EINTR) {
+				return firstsize + secondsize;
+			}
+		}
+#endif
+	}
+
+};
+
+
+
+// The status of an execution, which is returned by the interpret and execute methods.
+// STATUS_OUT_OF_MEMORY and STATUS_INTERNAL_ERROR are never returned by the environment itself, but reported by wrappers such as libxlbf which catch the exhaustion of memory or any other exception within an execution.
+enum xl_brainfuck_status : int {
+	STATUS_OK,
+	STATUS_SYNTAX_ERROR,
+	STATUS_ACCESS_VIOLATION,
+	STATUS_INFINITE_LOOP,
+	STATUS_STEP_QUOTA,
+	STATUS_MEMORY_QUOTA,
+	STATUS_OUTPUT_QUOTA,
+	STATUS_TIME_QUOTA,
+	STATUS_PAUSED,
+	STATUS_OUT_OF_MEMORY,
+	STATUS_INTERNAL_ERROR
+};
+
+// The error which ended the latest execution, with the source offset of the command at which it occurred.
+struct xl_brainfuck_error {
+	xl_brainfuck_status status;
+	size_t sourceoffset;
+};
+
+// The resource quotas of a brainfuck environment, where a limit of zero means no limit.
+// A step is a trip of a loop, since the code between two trips is bounded by the length of the code. The pages are the pages of QUOTA_PAGE_SIZE bytes of the tape which the pointer may reach from its start, and the seconds are the wall time spent executing.
+struct xl_brainfuck_quota {
+	unsigned long long steps;
+	size_t pages;
+	size_t outputbytes;
+	double seconds;
+};
+
+// The resources used by a brainfuck environment since its quotas were set.
+struct xl_brainfuck_usage {
+	unsigned long long steps;
+	size_t outputbytes;
+	double seconds;
+	size_t inputbytes;
+};
+
+// The quotas are enforced at the trips of loops and at I/O, where the step count and the wall time are checked every QUOTA_CHECK_INTERVAL trips.
+constexpr size_t QUOTA_PAGE_SIZE = 4096;
+constexpr long long QUOTA_CHECK_INTERVAL = 65536;
+
+// The state of an execution at a checkpoint, from which the execution can be resumed in an environment with a tape of the same size, see the setcheckpointer method.
+// The state comprises the tape, the offset of the pointer from the start of the tape, the bytecode offset of the next instruction, and the resources used so far, including the bytes of input read and of output written.
 template<typename storage_t>
-class xl_brainfuck_env {
+struct xl_brainfuck_state {
+	const storage_t *tape;
+	size_t tapesize;
+	size_t ptroffset;
+	size_t bytecodeoffset;
+	xl_brainfuck_usage usage;
+};
+
+// A handler of checkpoints, whose save function receives the state of an execution every interval seconds of the execution.
+template<typename storage_t>
+struct xl_brainfuck_checkpointer {
+	void (*save)(void *context, const xl_brainfuck_state<storage_t> &state);
+	void *context;
+	double interval;
+};
+
+
+
+// A tape backed by a file is mapped in pages of TAPE_PAGE_SIZE bytes, and the kernel is advised on its access at the checks of the quotas. Once the pointer has moved at least TAPE_ADVICE_MIN_BYTES in the same direction between checks, the tape is read sequentially and TAPE_ADVICE_AHEAD_BYTES ahead of the pointer are read in advance.
+constexpr size_t TAPE_PAGE_SIZE = 4096;
+constexpr size_t TAPE_ADVICE_MIN_BYTES = 4096;
+constexpr size_t TAPE_ADVICE_AHEAD_BYTES = 4 << 20;
+
+// A tape of at least TAPE_SPARSE_MIN_BYTES in memory is mapped sparsely, and a smaller tape is allocated from the heap.
+constexpr size_t TAPE_SPARSE_MIN_BYTES = 1 << 20;
+
+
+
+// The time travel of an xl_brainfuck_timeline snapshots the tape in pages of TIMELINE_PAGE_SIZE bytes, every TIMELINE_SNAPSHOT_INTERVAL seconds of the execution at first.
+// Once there are more than TIMELINE_MAX_SNAPSHOTS snapshots, every other one is dropped and the interval doubles, so that the snapshots stay spread over the whole execution.
+constexpr size_t TIMELINE_PAGE_SIZE = 4096;
+constexpr double TIMELINE_SNAPSHOT_INTERVAL = 0.05;
+constexpr size_t TIMELINE_MAX_SNAPSHOTS = 64;
+
+
+// Limits of the loop memoization.
+// Loops touching more cells than MEMO_MAX_WINDOW are never memoized, and each loop stores at most MEMO_MAX_ENTRIES results.
+// After MEMO_WARMUP_PROBES probes, a loop keeps its cache only if at least MEMO_MIN_HIT_PERCENT percent of the probes were hits.
+constexpr ptrdiff_t MEMO_MAX_WINDOW = 16;
+constexpr size_t MEMO_MAX_ENTRIES = 65536;
+constexpr unsigned long MEMO_WARMUP_PROBES = 256;
+constexpr unsigned long MEMO_MIN_HIT_PERCENT = 50;
+
+
+
+// The detection of infinite loops compares the window of a pure loop every LOOP_CHECK_INTERVAL trips against a snapshot taken at a power of two times the interval, so that any cycle of states is found once the snapshot falls within it.
+constexpr unsigned long long LOOP_CHECK_INTERVAL = 1024;
+
+
+
+// Parameters of the scan loops, which move the pointer by a fixed stride until a zero cell is found.
+// The scan prefetches the cells SCAN_PREFETCH_BYTES ahead of the pointer once per cache line of CACHE_LINE_SIZE bytes. When the previous trip of the same scan covered more than SCAN_LLC_SIZE bytes, the cells are prefetched as non-temporal so that the scan does not evict the working set from the last-level cache.
+constexpr size_t CACHE_LINE_SIZE = 64;
+constexpr size_t SCAN_PREFETCH_BYTES = 1024;
+constexpr size_t SCAN_LLC_SIZE = 32 << 20;
+
+
+
+// Thresholds of the profile-guided translation.
+// A loop condition is translated as likely if at least PROFILE_LIKELY_PERCENT percent of its evaluations were true, and as unlikely if at most PROFILE_UNLIKELY_PERCENT percent were. A loop which always ran the same number of times, up to PROFILE_UNROLL_MAX_TRIP, is unrolled.
+constexpr unsigned long long PROFILE_LIKELY_PERCENT = 90;
+constexpr unsigned long long PROFILE_UNLIKELY_PERCENT = 10;
+constexpr unsigned long long PROFILE_UNROLL_MAX_TRIP = 8;
+
+
+
+// Loops which always ran the same number of times, up to SPECULATE_MAX_TRIP, are specialized by the bytecode compiler.
+constexpr unsigned long long SPECULATE_MAX_TRIP = 8;
+
+
+
+// The cost model of xl_brainfuck_adaptiveprogram. A profiled execution is assumed to take ADAPTIVE_PROFILE_OVERHEAD times as long as a plain one, and specialization to save ADAPTIVE_EXPECTED_GAIN of the time of each execution.
+// ADAPTIVE_PROFILE_RUNS executions are profiled before the code is recompiled, and as many specialized executions are timed before the recompilation is kept, unless they are slower than the plain ones by ADAPTIVE_REVERT_MARGIN.
+constexpr double ADAPTIVE_PROFILE_OVERHEAD = 1.5;
+constexpr double ADAPTIVE_EXPECTED_GAIN = 0.1;
+constexpr unsigned long long ADAPTIVE_PROFILE_RUNS = 4;
+constexpr double ADAPTIVE_REVERT_MARGIN = 1.05;
+
+
+
+// Loops with fewer commands than DEDUP_MIN_COMMANDS are cheaper to translate inline than to share between their sites.
+constexpr size_t DEDUP_MIN_COMMANDS = 16;
+
+
+
+// The statistics of a translation, which are reported by the translator application.
+// The dedup ratio of the translation is the number of shared loop sites per shared function.
+struct xl_brainfuck_translate_stats {
+	size_t loopsites;
+	size_t sharedsites;
+	size_t sharedfunctions;
+};
+
+
+
+// Prefetches the cache line at the address for reading, either into all levels of the cache or as non-temporal data.
+// Prefetching never faults, hence the address may lie beyond the tape.
+template<bool NONTEMPORAL>
+inline void prefetch(const void *address) {
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+	_mm_prefetch((const char *)address, NONTEMPORAL ? _MM_HINT_NTA : _MM_HINT_T0);
+#elif defined(__GNUC__)
+	__builtin_prefetch(address, 0, NONTEMPORAL ? 0 : 3);
+#else
+	(void)address;
+#endif
+}
+
+
+
+// Keeps the slow paths of the interpreter, such as the checks of the quotas and the reports of errors, out of the instruction stream of its hot loop.
+#if defined(_MSC_VER)
+#define XLBF_NOINLINE __declspec(noinline)
+#elif defined(__GNUC__)
+#define XLBF_NOINLINE __attribute__((noinline))
+#else
+#define XLBF_NOINLINE
+#endif
+
+
+
+// Appends an unsigned value to the bytecode as a varint of seven bits per byte, where the high bit of each byte marks that more bytes follow.
+inline void appendvarint(std::vector<unsigned char> &bytecode, unsigned long long value) {
+	while (value >= 0x80) {
+		bytecode.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	bytecode.push_back((unsigned char)value);
+}
+
+// Appends a signed value to the bytecode as a zigzag varint, so that values of small magnitude take a single byte regardless of sign.
+inline void appendsignedvarint(std::vector<unsigned char> &bytecode, long long value) {
+	appendvarint(bytecode, ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63));
+}
+
+// Reads a varint at the pointer and moves the pointer past it.
+inline unsigned long long readvarint(const unsigned char **ptr) {
+	unsigned long long value = **ptr & 0x7f;
+	unsigned shift = 7;
+	while (*(*ptr)++ & 0x80) {
+		value |= (unsigned long long)(**ptr & 0x7f) << shift;
+		shift += 7;
+	}
+	return value;
+}
+
+// Reads a zigzag varint at the pointer and moves the pointer past it.
+inline long long readsignedvarint(const unsigned char **ptr) {
+	unsigned long long value = readvarint(ptr);
+	return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+// Counts the bytes taken by an unsigned value encoded as a varint.
+inline size_t varintsize(unsigned long long value) {
+	size_t size = 1;
+	while (value >= 0x80) {
+		value >>= 7;
+		size++;
+	}
+	return size;
+}
+
+
+
+// The opcodes of the bytecode. Each opcode takes a single byte and is followed by its operands, if any, as varints.
+// The jump of OP_LOOPBEGIN counts the bytes from the end of the instruction to the end of the matching OP_LOOPEND, and the jump of OP_LOOPEND counts the bytes back from its operands to the start of the loop body.
+// The pure loops, which are balanced and free of I/O, use OP_MEMOBEGIN and OP_MEMOEND instead, which carry the index of the loop in the loop table after the jump.
+// A loop consisting of a single pointer movement is compiled into OP_SCAN, which carries the stride and the index of the scan.
+// A loop which never changes its cell is preceded by OP_NOPROGRESS, which carries the window of the body.
+// A loop specialized on its profile is preceded by OP_SPECTRIP, which carries the speculated trip count, the change of the loop cell per trip, the window of the body, and the offsets of the start and end of the body and of the end of the loop relative to the end of the instruction.
+// OP_TRAP replaces the opcode of an instruction with a breakpoint, whose original opcode is kept in the trap table of the program.
+enum xl_brainfuck_opcode : unsigned char {
+	OP_END,
+	OP_ADD,
+	OP_MOVE,
+	OP_OUTPUT,
+	OP_OUTPUTNUM,
+	OP_INPUT,
+	OP_LOOPBEGIN,
+	OP_LOOPEND,
+	OP_MEMOBEGIN,
+	OP_MEMOEND,
+	OP_SCAN,
+	OP_SPECTRIP,
+	OP_NOPROGRESS,
+	OP_UNMATCHEDBEGIN,
+	OP_UNMATCHEDEND,
+	OP_TRAP
+};
+
+// Maps the bytecode offset of an instruction to the source offset of the command it was compiled from.
+struct xl_brainfuck_sourcemapentry {
+	unsigned bytecodeoffset;
+	unsigned sourceoffset;
+};
+
+// An instruction whose opcode is replaced by OP_TRAP, with its original opcode and its size in bytes.
+// A specialized loop with a breakpoint in its body is trapped without being a breakpoint itself, so that it always runs the generic loop instead.
+struct xl_brainfuck_trap {
+	unsigned char opcode;
+	bool isbreakpoint;
+	size_t size;
+};
+
+// Describes a pure loop, which touches only the cells from windowmin to windowmax relative to the pointer, and which is memoized if its window is narrow enough.
+struct xl_brainfuck_loopinfo {
+	ptrdiff_t windowmin;
+	ptrdiff_t windowmax;
+	bool memoizable;
+};
+
+
+
+// The profile of a loop, keyed by the source offset of its '['.
+// A loop is entered each time it is reached, and taken if its body runs at least once. The trip count of an entry is the number of times the body runs before the loop exits.
+struct xl_brainfuck_loopprofile {
+	unsigned long long entries;
+	unsigned long long taken;
+	unsigned long long iterations;
+	unsigned long long mintrip;
+	unsigned long long maxtrip;
+};
 
-	// The tape and ptr variables implements the conceptualization of brainfuck as operating on a tape with a head pointing to one cell on the tape. In addition, the variables minaddr and maxaddr are defined to ensure that the pointer does not read beyond the memory assigned to the program.
-	storage_t *tape;
-	storage_t *ptr;
-	storage_t *minaddr;
-	storage_t *maxaddr;
+
+
+// The xl_brainfuck_profile class, which records the behaviour of a block of brainfuck code over one or more executions.
+// The profile holds the trip counts and branch directions of each loop and the range of values stored into the cells. It is saved into and loaded from a text file, so that the translator can optimize a program for the inputs it was profiled on.
+class xl_brainfuck_profile {
 
 public:
 
-	// The constructor which fixes the storage size of the brainfuck environment upon instantiation.
-	xl_brainfuck_env(size_t tapesize) {
-		// Rejects non-integral storage types at compile time.
-		static_assert(std::is_integral<storage_t>::value,
-			"Cells in the tape must store integral values.");
-		// Allocates an zero-initialized memory block with the program pointer pointing at the start of the block.
-		this->tape = (storage_t *)calloc(tapesize, sizeof(storage_t));
-		this->ptr = this->tape;
-		this->minaddr = this->tape;
-		this->maxaddr = this->tape + tapesize - 1;
+	std::map<size_t, xl_brainfuck_loopprofile> loops;
+	bool hascells;
+	long long cellmin;
+	long long cellmax;
+
+	xl_brainfuck_profile() {
+		this->clear();
 	}
-	// The destructor which frees the memory occupied by the tape.
-	~xl_brainfuck_env() {
-		free(tape);
+
+	// Discards all records of the profile.
+	void clear() {
+		this->loops.clear();
+		this->hascells = false;
+		this->cellmin = 0;
+		this->cellmax = 0;
+	}
+
+	// Records an entry of the loop at the source offset which ran its body the given number of times.
+	void recordtrip(size_t sourceoffset, unsigned long long trips) {
+		auto loopfound = this->loops.find(sourceoffset);
+		if (loopfound == this->loops.end()) {
+			loopfound = this->loops.emplace(sourceoffset, xl_brainfuck_loopprofile{ 0, 0, 0, trips, trips }).first;
+		}
+		xl_brainfuck_loopprofile &loop = loopfound->second;
+		loop.entries++;
+		loop.taken += trips > 0 ? 1 : 0;
+		loop.iterations += trips;
+		loop.mintrip = std::min(loop.mintrip, trips);
+		loop.maxtrip = std::max(loop.maxtrip, trips);
+	}
+
+	// Records a value stored into a cell.
+	void recordcell(long long value) {
+		if (!this->hascells) {
+			this->hascells = true;
+			this->cellmin = value;
+			this->cellmax = value;
+		}
+		this->cellmin = std::min(this->cellmin, value);
+		this->cellmax = std::max(this->cellmax, value);
+	}
+
+	// Adds the records of another profile of the same code, as if its executions had been recorded into this profile.
+	void merge(const xl_brainfuck_profile &other) {
+		for (const auto &otherloop : other.loops) {
+			auto loopfound = this->loops.find(otherloop.first);
+			if (loopfound == this->loops.end()) {
+				this->loops.insert(otherloop);
+				continue;
+			}
+			xl_brainfuck_loopprofile &loop = loopfound->second;
+			loop.entries += otherloop.second.entries;
+			loop.taken += otherloop.second.taken;
+			loop.iterations += otherloop.second.iterations;
+			loop.mintrip = std::min(loop.mintrip, otherloop.second.mintrip);
+			loop.maxtrip = std::max(loop.maxtrip, otherloop.second.maxtrip);
+		}
+		if (other.hascells) {
+			this->recordcell(other.cellmin);
+			this->recordcell(other.cellmax);
+		}
+	}
+
+	// Returns the profile of the loop at the source offset, or nullptr if the loop was never reached.
+	const xl_brainfuck_loopprofile *findloop(size_t sourceoffset) const {
+		auto loopfound = this->loops.find(sourceoffset);
+		return loopfound == this->loops.end() ? nullptr : &loopfound->second;
+	}
+
+	// Saves the profile into a file, and returns 0 on success or 1 if the file cannot be written.
+	int save(const char *path) const {
+		FILE *fp = fopen(path, "w");
+		if (fp == nullptr) {
+			return 1;
+		}
+		fprintf(fp, "xlbfprofile 1\n");
+		if (this->hascells) {
+			fprintf(fp, "cells %lld %lld\n", this->cellmin, this->cellmax);
+		}
+		for (const auto &loop : this->loops) {
+			fprintf(fp, "loop %llu %llu %llu %llu %llu %llu\n", (unsigned long long)loop.first,
+				loop.second.entries, loop.second.taken, loop.second.iterations, loop.second.mintrip, loop.second.maxtrip);
+		}
+		fclose(fp);
+		return 0;
+	}
+
+	// Loads the profile from a file, replacing any records, and returns 0 on success or 1 if the file cannot be read or is not a profile.
+	int load(const char *path) {
+		this->clear();
+		FILE *fp = fopen(path, "r");
+		if (fp == nullptr) {
+			return 1;
+		}
+		char line[256];
+		int version = 0;
+		if (fgets(line, sizeof(line), fp) == nullptr || sscanf(line, "xlbfprofile %d", &version) != 1 || version != 1) {
+			fclose(fp);
+			return 1;
+		}
+		while (fgets(line, sizeof(line), fp) != nullptr) {
+			unsigned long long sourceoffset;
+			xl_brainfuck_loopprofile loop;
+			if (sscanf(line, "cells %lld %lld", &this->cellmin, &this->cellmax) == 2) {
+				this->hascells = true;
+			} else if (sscanf(line, "loop %llu %llu %llu %llu %llu %llu", &sourceoffset,
+				&loop.entries, &loop.taken, &loop.iterations, &loop.mintrip, &loop.maxtrip) == 6) {
+				this->loops[(size_t)sourceoffset] = loop;
+			}
+		}
+		fclose(fp);
+		return 0;
+	}
+
+};
+
+
+
+// The magic at the start of a serialized program, whose version is bumped whenever the bytecode or the layout changes.
+constexpr char PROGRAM_MAGIC[] = "XLBFCOD2";
+
+// The trailer at the end of a bundled executable, which is a copy of the runner followed by a serialized program and the trailer.
+// The runner finds the program through the trailer of its own executable, and runs it on a tape of memsize cells.
+struct xl_brainfuck_bundletrailer {
+	unsigned long long programsize;
+	unsigned long long memsize;
+	unsigned long long programhash;
+	char magic[8];
+};
+
+// The xl_brainfuck_program class, which holds a block of brainfuck code compiled into bytecode.
+// Consecutive + and -, as well as > and <, are collated into single instructions with the net change as operand, and miscellaneous characters are dropped. The source map is kept aside the bytecode so that the hot instruction stream stays dense.
+class xl_brainfuck_program {
+
+	template<typename storage_t> friend class xl_brainfuck_env;
+
+	std::vector<unsigned char> bytecode;
+	std::vector<xl_brainfuck_sourcemapentry> sourcemap;
+	std::vector<xl_brainfuck_loopinfo> loops;
+	size_t scans;
+
+	// The number of loops which a profile could specialize, and the number which the profile of the compilation did specialize.
+	size_t candidates;
+	size_t specialized;
+
+	// The trapped instructions by bytecode offset, and the bytecode offsets of the breakpoints.
+	std::map<size_t, xl_brainfuck_trap> traps;
+	std::vector<size_t> breakpoints;
+
+	// The range of offsets from the starting cell which the pointer may reach, if it could be proved, see the bounds method.
+	bool bounded;
+	ptrdiff_t minoffset;
+	ptrdiff_t maxoffset;
+
+	// A loop being compiled, whose body is compiled into its own buffers and wrapped with the loop instructions once the matching ']' is found.
+	// The offset, window and purity of the loop are tracked to determine if the loop can be memoized, and the loop is bounded if it and every loop nested in it is balanced.
+	struct compileframe {
+		std::vector<unsigned char> bytecode;
+		std::vector<xl_brainfuck_sourcemapentry> sourcemap;
+		unsigned sourceoffset;
+		ptrdiff_t offset;
+		ptrdiff_t windowmin;
+		ptrdiff_t windowmax;
+		bool pure;
+		bool bounded;
+		bool hasloops;
+		bool hasinput;
+		long long celldelta;
+	};
+
+public:
+
+	// Compiles a block of brainfuck code, replacing any bytecode previously held.
+	// Unenclosed loops are compiled into instructions which report the syntax error when they are reached, as the interpretation of the code directly would.
+	// If a profile of the code is supplied, the loops which always ran the same small number of times are specialized, see OP_SPECTRIP.
+	void compile(const char *code, const xl_brainfuck_profile *profile = nullptr) {
+		std::vector<compileframe> frames(1);
+		frames.back().sourceoffset = 0;
+		frames.back().offset = 0;
+		frames.back().windowmin = 0;
+		frames.back().windowmax = 0;
+		frames.back().pure = true;
+		frames.back().bounded = true;
+		frames.back().hasloops = false;
+		frames.back().hasinput = false;
+		frames.back().celldelta = 0;
+		this->loops.clear();
+		this->scans = 0;
+		this->candidates = 0;
+		this->specialized = 0;
+		this->traps.clear();
+		this->breakpoints.clear();
+
+		const char *codeptr = code;
+		while (*codeptr != 0) {
+			compileframe &frame = frames.back();
+			const unsigned sourceoffset = (unsigned)(codeptr - code);
+
+			switch (*codeptr) {
+
+			case '+': case '-': case '>': case '<': {
+				// Collates the net change of consecutive commands of the same kind, skipping miscellaneous characters in between.
+				const bool ismove = *codeptr == '>' || *codeptr == '<';
+				long long totalchange = 0;
+				while (*codeptr != 0) {
+					if (*codeptr == (ismove ? '>' : '+')) {
+						totalchange++;
+					} else if (*codeptr == (ismove ? '<' : '-')) {
+						totalchange--;
+					} else if (strchr("+-<>.,:[]", *codeptr) != nullptr) {
+						break;
+					}
+					codeptr++;
+				}
+				// A net change of zero still checks the address of the cell, hence only net pointer movements of zero are dropped.
+				if (totalchange != 0 || !ismove) {
+					frame.sourcemap.push_back({ (unsigned)frame.bytecode.size(), sourceoffset });
+					frame.bytecode.push_back(ismove ? OP_MOVE : OP_ADD);
+					appendsignedvarint(frame.bytecode, totalchange);
+					if (ismove) {
+						frame.offset += (ptrdiff_t)totalchange;
+						frame.windowmin = std::min(frame.windowmin, frame.offset);
+						frame.windowmax = std::max(frame.windowmax, frame.offset);
+					} else if (frame.offset == 0) {
+						frame.celldelta += totalchange;
+					}
+				}
+				continue;
+			}
+
+			case '.': case ':': case ',': {
+				frame.sourcemap.push_back({ (unsigned)frame.bytecode.size(), sourceoffset });
+				frame.bytecode.push_back(*codeptr == '.' ? OP_OUTPUT : *codeptr == ':' ? OP_OUTPUTNUM : OP_INPUT);
+				frame.pure = false;
+				frame.hasinput = frame.hasinput || *codeptr == ',';
+				break;
+			}
+
+			case '[': {
+				compileframe loopframe;
+				loopframe.sourceoffset = sourceoffset;
+				loopframe.offset = 0;
+				loopframe.windowmin = 0;
+				loopframe.windowmax = 0;
+				loopframe.pure = true;
+				loopframe.bounded = true;
+				loopframe.hasloops = false;
+				loopframe.hasinput = false;
+				loopframe.celldelta = 0;
+				frames.push_back(std::move(loopframe));
+				break;
+			}
+
+			case ']': {
+				if (frames.size() == 1) {
+					frame.sourcemap.push_back({ (unsigned)frame.bytecode.size(), sourceoffset });
+					frame.bytecode.push_back(OP_UNMATCHEDEND);
+					break;
+				}
+				compileframe loopframe = std::move(frames.back());
+				frames.pop_back();
+				compileframe &parentframe = frames.back();
+
+				// A loop is pure if it is balanced and free of I/O, where the same must hold for every loop nested in it, and memoizable if it is also narrow enough.
+				const bool isbalanced = loopframe.offset == 0;
+				const bool ispure = isbalanced && loopframe.pure;
+				const bool ismemoizable = ispure && loopframe.windowmax - loopframe.windowmin < MEMO_MAX_WINDOW;
+				parentframe.pure = parentframe.pure && isbalanced && loopframe.pure;
+				parentframe.bounded = parentframe.bounded && isbalanced && loopframe.bounded;
+				parentframe.windowmin = std::min(parentframe.windowmin, parentframe.offset + loopframe.windowmin);
+				parentframe.windowmax = std::max(parentframe.windowmax, parentframe.offset + loopframe.windowmax);
+				parentframe.hasloops = true;
+
+				// Encodes a loop consisting of a single pointer movement as a scan.
+				if (loopframe.sourcemap.size() == 1 && loopframe.bytecode[0] == OP_MOVE) {
+					const unsigned char *strideptr = loopframe.bytecode.data() + 1;
+					parentframe.sourcemap.push_back({ (unsigned)parentframe.bytecode.size(), loopframe.sourceoffset });
+					parentframe.bytecode.push_back(OP_SCAN);
+					appendsignedvarint(parentframe.bytecode, readsignedvarint(&strideptr));
+					appendvarint(parentframe.bytecode, this->scans++);
+					break;
+				}
+
+				// Encodes the loop instructions around the body.
+				const unsigned long long backjump = loopframe.bytecode.size() + 1;
+				std::vector<unsigned char> loopend;
+				loopend.push_back(ispure ? OP_MEMOEND : OP_LOOPEND);
+				appendvarint(loopend, backjump);
+				if (ispure) {
+					appendvarint(loopend, this->loops.size());
+				}
+				std::vector<unsigned char> loopbegin;
+				loopbegin.push_back(ispure ? OP_MEMOBEGIN : OP_LOOPBEGIN);
+				appendvarint(loopbegin, loopframe.bytecode.size() + loopend.size());
+				if (ispure) {
+					appendvarint(loopbegin, this->loops.size());
+					this->loops.push_back({ loopframe.windowmin, loopframe.windowmax, ismemoizable });
+				}
+
+				// A pure loop without nested loops whose additions to its cell cancel out never changes its cell, hence it never ends once entered.
+				if (ispure && !loopframe.hasloops && loopframe.celldelta == 0) {
+					parentframe.sourcemap.push_back({ (unsigned)parentframe.bytecode.size(), loopframe.sourceoffset });
+					parentframe.bytecode.push_back(OP_NOPROGRESS);
+					appendsignedvarint(parentframe.bytecode, loopframe.windowmin);
+					appendsignedvarint(parentframe.bytecode, loopframe.windowmax);
+				}
+
+				// Specializes a loop which always ran the same small number of times, if its body is flat, balanced and free of input, so that the change of the loop cell per trip is known.
+				const xl_brainfuck_loopprofile *loopprofile = profile == nullptr ? nullptr : profile->findloop(loopframe.sourceoffset);
+				const bool iscandidate = isbalanced && !loopframe.hasloops && !loopframe.hasinput && loopframe.celldelta != 0;
+				this->candidates += iscandidate ? 1 : 0;
+				if (loopprofile != nullptr && iscandidate &&
+					loopprofile->mintrip == loopprofile->maxtrip && loopprofile->maxtrip >= 2 && loopprofile->maxtrip <= SPECULATE_MAX_TRIP) {
+					this->specialized++;
+					parentframe.sourcemap.push_back({ (unsigned)parentframe.bytecode.size(), loopframe.sourceoffset });
+					parentframe.bytecode.push_back(OP_SPECTRIP);
+					appendvarint(parentframe.bytecode, loopprofile->maxtrip);
+					appendsignedvarint(parentframe.bytecode, loopframe.celldelta);
+					appendsignedvarint(parentframe.bytecode, loopframe.windowmin);
+					appendsignedvarint(parentframe.bytecode, loopframe.windowmax);
+					appendvarint(parentframe.bytecode, loopbegin.size());
+					appendvarint(parentframe.bytecode, loopbegin.size() + loopframe.bytecode.size());
+					appendvarint(parentframe.bytecode, loopbegin.size() + loopframe.bytecode.size() + loopend.size());
+				}
+
+				parentframe.sourcemap.push_back({ (unsigned)parentframe.bytecode.size(), loopframe.sourceoffset });
+				parentframe.bytecode.insert(parentframe.bytecode.end(), loopbegin.begin(), loopbegin.end());
+				const unsigned bodyoffset = (unsigned)parentframe.bytecode.size();
+				for (const xl_brainfuck_sourcemapentry &entry : loopframe.sourcemap) {
+					parentframe.sourcemap.push_back({ bodyoffset + entry.bytecodeoffset, entry.sourceoffset });
+				}
+				parentframe.bytecode.insert(parentframe.bytecode.end(), loopframe.bytecode.begin(), loopframe.bytecode.end());
+				parentframe.sourcemap.push_back({ (unsigned)parentframe.bytecode.size(), sourceoffset });
+				parentframe.bytecode.insert(parentframe.bytecode.end(), loopend.begin(), loopend.end());
+				break;
+			}
+
+			}
+
+			codeptr++;
+		}
+
+		// Reduces each unenclosed loop to the instruction reporting it, as the code following it can never be reached.
+		while (frames.size() > 1) {
+			const unsigned sourceoffset = frames.back().sourceoffset;
+			frames.pop_back();
+			frames.back().sourcemap.push_back({ (unsigned)frames.back().bytecode.size(), sourceoffset });
+			frames.back().bytecode.push_back(OP_UNMATCHEDBEGIN);
+		}
+
+		frames.back().sourcemap.push_back({ (unsigned)frames.back().bytecode.size(), (unsigned)(codeptr - code) });
+		frames.back().bytecode.push_back(OP_END);
+		this->bytecode = std::move(frames.back().bytecode);
+		this->sourcemap = std::move(frames.back().sourcemap);
+		this->bounded = frames.back().bounded;
+		this->minoffset = frames.back().windowmin;
+		this->maxoffset = frames.back().windowmax;
+	}
+
+	// Determines the range of offsets from the starting cell which the pointer may reach when the code is executed, and returns true if the range could be proved.
+	// The range is proved if every loop of the code is balanced, whereby each loop returns the pointer to the cell where it started, so that the cells reached by the code are known regardless of the number of trips. Loops which drift, such as scans, make the range unprovable.
+	bool bounds(ptrdiff_t *minoffset, ptrdiff_t *maxoffset) const {
+		*minoffset = this->minoffset;
+		*maxoffset = this->maxoffset;
+		return this->bounded;
+	}
+
+	// Returns the number of loops which a profile could specialize, see OP_SPECTRIP, and stores the number of them that the profile given to the compilation did specialize.
+	size_t speculable(size_t *specialized) const {
+		*specialized = this->specialized;
+		return this->candidates;
+	}
+
+	// Returns the size of the bytecode in bytes.
+	size_t size() const {
+		return this->bytecode.size();
+	}
+
+	// Returns a hash of the bytecode, which identifies the compiled program for a checkpoint, as the bytecode offsets of the checkpoint are only valid for the same bytecode.
+	unsigned long long hash() const {
+		unsigned long long hash = 14695981039346656037ull;
+		for (unsigned char byte : this->bytecode) {
+			hash = (hash ^ byte) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Serializes the compiled program into the buffer, so that it can be executed later without its source code or the profile it was compiled with, see the deserialize method.
+	// The layout is that of the machine which compiled the program, and breakpoints are left out.
+	void serialize(std::vector<unsigned char> &data) const {
+		const unsigned long long fields[] = { this->bytecode.size(), this->sourcemap.size(), this->loops.size(), this->scans,
+			this->bounded, (unsigned long long)this->minoffset, (unsigned long long)this->maxoffset, this->candidates, this->specialized };
+		data.insert(data.end(), PROGRAM_MAGIC, PROGRAM_MAGIC + sizeof(PROGRAM_MAGIC) - 1);
+		data.insert(data.end(), (const unsigned char *)fields, (const unsigned char *)(fields + 9));
+		const size_t bytecodestart = data.size();
+		data.insert(data.end(), this->bytecode.begin(), this->bytecode.end());
+		for (const auto &trap : this->traps) {
+			data[bytecodestart + trap.first] = trap.second.opcode;
+		}
+		data.insert(data.end(), (const unsigned char *)this->sourcemap.data(), (const unsigned char *)(this->sourcemap.data() + this->sourcemap.size()));
+		for (const xl_brainfuck_loopinfo &loop : this->loops) {
+			const long long loopfields[] = { (long long)loop.windowmin, (long long)loop.windowmax, loop.memoizable };
+			data.insert(data.end(), (const unsigned char *)loopfields, (const unsigned char *)(loopfields + 3));
+		}
+	}
+
+	// Replaces the program with one serialized by the serialize method, and returns false if the data is not a serialized program of the same layout, in which case the program is left unchanged.
+	bool deserialize(const unsigned char *data, size_t size) {
+		const size_t magicsize = sizeof(PROGRAM_MAGIC) - 1;
+		unsigned long long fields[9];
+		if (size < magicsize + sizeof(fields) || memcmp(data, PROGRAM_MAGIC, magicsize) != 0) {
+			return false;
+		}
+		memcpy(fields, data + magicsize, sizeof(fields));
+		if (fields[0] == 0 || fields[0] > size || fields[1] > size || fields[2] > size ||
+			magicsize + sizeof(fields) + fields[0] + fields[1] * sizeof(xl_brainfuck_sourcemapentry) + fields[2] * 3 * sizeof(long long) != size ||
+			data[magicsize + sizeof(fields) + fields[0] - 1] != OP_END) {
+			return false;
+		}
+		const unsigned char *dataptr = data + magicsize + sizeof(fields);
+		this->bytecode.assign(dataptr, dataptr + fields[0]);
+		dataptr += fields[0];
+		this->sourcemap.resize((size_t)fields[1]);
+		memcpy(this->sourcemap.data(), dataptr, this->sourcemap.size() * sizeof(xl_brainfuck_sourcemapentry));
+		dataptr += this->sourcemap.size() * sizeof(xl_brainfuck_sourcemapentry);
+		this->loops.resize((size_t)fields[2]);
+		for (xl_brainfuck_loopinfo &loop : this->loops) {
+			long long loopfields[3];
+			memcpy(loopfields, dataptr, sizeof(loopfields));
+			loop = { (ptrdiff_t)loopfields[0], (ptrdiff_t)loopfields[1], loopfields[2] != 0 };
+			dataptr += sizeof(loopfields);
+		}
+		this->scans = (size_t)fields[3];
+		this->bounded = fields[4] != 0;
+		this->minoffset = (ptrdiff_t)fields[5];
+		this->maxoffset = (ptrdiff_t)fields[6];
+		this->candidates = (size_t)fields[7];
+		this->specialized = (size_t)fields[8];
+		this->traps.clear();
+		this->breakpoints.clear();
+		return true;
+	}
+
+	// Returns the source offset of the command from which the instruction at the bytecode offset was compiled.
+	size_t sourceoffset(size_t bytecodeoffset) const {
+		auto entryfound = std::upper_bound(this->sourcemap.begin(), this->sourcemap.end(), bytecodeoffset,
+			[](size_t offset, const xl_brainfuck_sourcemapentry &entry) { return offset < entry.bytecodeoffset; });
+		return entryfound == this->sourcemap.begin() ? 0 : (entryfound - 1)->sourceoffset;
+	}
+
+	// Sets a breakpoint on the first instruction compiled from a command at or after the source offset, which pauses an execution before the instruction runs, and returns the source offset of that command, or -1 if there is none.
+	// The breakpoint is patched into the bytecode as OP_TRAP, so that the code without breakpoints runs as fast as before. The program must not be executed while its breakpoints change.
+	size_t setbreakpoint(size_t sourceoffset) {
+		const xl_brainfuck_sourcemapentry *instruction = nullptr;
+		for (const xl_brainfuck_sourcemapentry &entry : this->sourcemap) {
+			if (entry.sourceoffset >= sourceoffset && this->opcodeat(entry.bytecodeoffset) != OP_END &&
+				(instruction == nullptr || entry.sourceoffset < instruction->sourceoffset)) {
+				instruction = &entry;
+			}
+		}
+		if (instruction == nullptr) {
+			return (size_t)-1;
+		}
+		if (std::find(this->breakpoints.begin(), this->breakpoints.end(), instruction->bytecodeoffset) == this->breakpoints.end()) {
+			this->breakpoints.push_back(instruction->bytecodeoffset);
+			this->patchtraps();
+		}
+		return instruction->sourceoffset;
+	}
+
+	// Clears the breakpoints on the instructions compiled from the command at the source offset, and returns false if there are none.
+	bool clearbreakpoint(size_t sourceoffset) {
+		const size_t count = this->breakpoints.size();
+		this->breakpoints.erase(std::remove_if(this->breakpoints.begin(), this->breakpoints.end(),
+			[&](size_t offset) { return this->sourceoffset(offset) == sourceoffset; }), this->breakpoints.end());
+		this->patchtraps();
+		return this->breakpoints.size() != count;
+	}
+
+	// Clears all breakpoints, restoring the original bytecode.
+	void clearbreakpoints() {
+		this->breakpoints.clear();
+		this->patchtraps();
+	}
+
+private:
+
+	// Returns the original opcode of the instruction at the bytecode offset, which may be trapped.
+	unsigned char opcodeat(size_t bytecodeoffset) const {
+		auto trapfound = this->traps.find(bytecodeoffset);
+		return trapfound != this->traps.end() ? trapfound->second.opcode : this->bytecode[bytecodeoffset];
+	}
+
+	// Restores the original opcodes, and traps the instructions with breakpoints and the specialized loops with breakpoints in their bodies.
+	void patchtraps() {
+		for (const auto &trap : this->traps) {
+			this->bytecode[trap.first] = trap.second.opcode;
+		}
+		this->traps.clear();
+		for (size_t index = 0; index < this->sourcemap.size(); index++) {
+			const size_t offset = this->sourcemap[index].bytecodeoffset;
+			const size_t size = (index + 1 < this->sourcemap.size() ? this->sourcemap[index + 1].bytecodeoffset : this->bytecode.size()) - offset;
+			bool isbreakpoint = std::find(this->breakpoints.begin(), this->breakpoints.end(), offset) != this->breakpoints.end();
+			bool istrapped = isbreakpoint;
+			if (this->bytecode[offset] == OP_SPECTRIP) {
+				// The offsets of the body follow the trip count, the change of the loop cell and the window.
+				const unsigned char *operand = this->bytecode.data() + offset + 1;
+				readvarint(&operand);
+				readsignedvarint(&operand);
+				readsignedvarint(&operand);
+				readsignedvarint(&operand);
+				const size_t bodystart = offset + size + (size_t)readvarint(&operand);
+				const size_t bodyend = offset + size + (size_t)readvarint(&operand);
+				for (size_t breakpoint : this->breakpoints) {
+					istrapped = istrapped || (breakpoint >= bodystart && breakpoint < bodyend);
+				}
+			}
+			if (istrapped) {
+				this->traps[offset] = { this->bytecode[offset], isbreakpoint, size };
+			}
+		}
+		for (const auto &trap : this->traps) {
+			this->bytecode[trap.first] = OP_TRAP;
+		}
+	}
+
+};
+
+
+
+// The xl_brainfuck_env class, where the template is provided to support multiple storage types.
+template<typename storage_t>
+class xl_brainfuck_env {
+
+	// The tape and ptr variables implements the conceptualization of brainfuck as operating on a tape with a head pointing to one cell on the tape. In addition, the variables minaddr and maxaddr are defined to ensure that the pointer does not read beyond the memory assigned to the program.
+	storage_t *tape;
+	storage_t *ptr;
+	storage_t *minaddr;
+	storage_t *maxaddr;
+
+	// The last cell of the tape, beyond which maxaddr is moved closer to the start when the pages of the tape are limited by a quota.
+	storage_t *tapeend;
+
+	// The offset of the cell at which the pointer starts from minaddr, to which the pointer returns when the environment is reset.
+	size_t origin;
+
+	// Whether the tape is circular, and the mask of the offset of the pointer from minaddr while it is, or zero otherwise.
+	bool circular;
+	size_t wrapmask;
+
+	// The file which backs the tape, or -1 if the tape is allocated in memory, with the size of its mapping, and the pointer and its direction of travel at the latest advice on the access to the tape.
+	int tapefd;
+	size_t tapebytes;
+	storage_t *adviseptr;
+	int advisedirection;
+
+	// Whether the tape in memory is mapped sparsely, in which case its untouched pages are the shared zero page and the pages which become zero are released.
+	bool sparsetape;
+
+	// The resource quotas and the resources used so far.
+	// The budget counts down the trips of loops until the quotas are next checked, and the grant is the budget given at the latest check.
+	xl_brainfuck_quota quota;
+	xl_brainfuck_usage usage;
+	long long budget;
+	long long budgetgrant;
+	std::chrono::steady_clock::time_point executionstart;
+
+	// The handler of checkpoints, whose save function is nullptr if checkpoints are disabled, and the time of the next checkpoint.
+	xl_brainfuck_checkpointer<storage_t> checkpointer;
+	std::chrono::steady_clock::time_point nextcheckpoint;
+
+	// The step at which executions pause, or zero if they run on.
+	// The watched cells, which are sorted, and the first and last of them, whose writes pause executions.
+	// The bytecode offset from which a paused execution resumes, and the offset of the breakpoint at which it paused, if any, which is passed over when it resumes.
+	unsigned long long stopstep;
+	std::vector<size_t> watchpoints;
+	storage_t *watchmin;
+	storage_t *watchmax;
+	size_t resumeoffset;
+	size_t trapoffset;
+
+	// The error which ended the latest execution, and whether errors are reported through the output channel.
+	xl_brainfuck_error error;
+	bool reporterrors;
+
+	// Enables the adaptive loop memoization of the interpret method.
+	bool memoize;
+
+	// Enables the detection of pure loops which return to a state they have been in, see the setloopdetection method.
+	bool detectloops;
+
+	// The profile into which executions are recorded, or nullptr if profiling is disabled.
+	xl_brainfuck_profile *profile;
+
+	// A loop being run while profiling, with the number of times its body has run so far.
+	struct profileactivation {
+		size_t sourceoffset;
+		unsigned long long trips;
+	};
+
+	// The input and output channels, and the output buffered until it is flushed to the output channel.
+	xl_brainfuck_io io;
+	// The output limit is the size to which the buffer may fill before it is flushed, which is smaller than the buffer near the end of an output quota.
+	char outputbuffer[OUTPUT_BUFFER_SIZE];
+	size_t outputsize;
+	size_t outputlimit;
+
+	// The statistics of the latest call of the translate method.
+	xl_brainfuck_translate_stats translatestats;
+
+	// A loop which occurs at several sites of the code and is translated into a shared function.
+	// The function is translated from the representative site, which is the first site of the loop in the code.
+	struct sharedloop {
+		size_t id;
+		const char *loopend;
+		const char *representative;
+	};
+
+	// Hashes the contents of a window of cells for the memoization cache.
+	struct windowhash {
+		size_t operator()(const std::vector<storage_t> &window) const {
+			size_t hash = 14695981039346656037ull;
+			const unsigned char *byteptr = (const unsigned char *)window.data();
+			for (size_t i = 0; i < window.size() * sizeof(storage_t); i++) {
+				hash = (hash ^ byteptr[i]) * 1099511628211ull;
+			}
+			return hash;
+		}
+	};
+
+	// The memoization state of a pure loop during an execution, and the state of the infinite loop detection since the loop was last entered.
+	struct memoloop {
+		bool disabled;
+		unsigned long probes;
+		unsigned long hits;
+		std::unordered_map<std::vector<storage_t>, std::vector<storage_t>, windowhash> cache;
+		unsigned long long trips;
+		unsigned long long nextsnapshot;
+		std::vector<storage_t> snapshot;
+	};
+
+	// The budget of an execution, which is copied from the environment into a local variable and written back when the execution returns, unless the execution is not budgeted.
+	struct localbudget {
+		long long *budget;
+		long long value;
+		~localbudget() {
+			if (this->budget != nullptr) {
+				*this->budget = this->value;
+			}
+		}
+	};
+
+	// A loop which missed the cache on entry and whose exit window is to be recorded.
+	struct memopending {
+		size_t loopindex;
+		std::vector<storage_t> window;
+	};
+
+public:
+
+	// The constructor which fixes the storage size of the brainfuck environment upon instantiation.
+	xl_brainfuck_env(size_t tapesize) : xl_brainfuck_env(tapesize, nullptr, false) {
+	}
+
+	// The constructor which backs the tape by a sparse file at the path rather than by memory, if the path is given, so that the tape may be larger than the physical memory. Only the pages of the tape which are written take space in the file, and the kernel pages the cells in and out as the pointer travels.
+	// The file is removed at once unless the tape is to be kept, in which case the file holds the final tape once the environment is destroyed. If the tape cannot be allocated, or the file cannot be created and mapped, the environment is not ready, see the isready method. Tape files are not supported on Windows.
+	xl_brainfuck_env(size_t tapesize, const char *tapepath, bool keeptape) {
+		// Rejects non-integral storage types at compile time.
+		static_assert(std::is_integral<storage_t>::value,
+			"Cells in the tape must store integral values.");
+		// Allocates an zero-initialized memory block with the program pointer pointing at the start of the block.
+		this->tapefd = -1;
+		this->tapebytes = tapesize * sizeof(storage_t);
+		this->sparsetape = false;
+		this->tape = tapepath == nullptr ? this->allocatetape(tapesize) : this->maptape(tapepath, keeptape);
+		this->adviseptr = this->tape;
+		this->advisedirection = 0;
+		this->ptr = this->tape;
+		this->minaddr = this->tape;
+		this->maxaddr = this->tape + tapesize - 1;
+		this->tapeend = this->maxaddr;
+		this->origin = 0;
+		this->circular = false;
+		this->wrapmask = 0;
+		this->quota = xl_brainfuck_quota();
+		this->usage = xl_brainfuck_usage();
+		this->budget = QUOTA_CHECK_INTERVAL;
+		this->budgetgrant = QUOTA_CHECK_INTERVAL;
+		this->checkpointer = { nullptr, nullptr, 0 };
+		this->stopstep = 0;
+		this->watchmin = nullptr;
+		this->watchmax = nullptr;
+		this->resumeoffset = 0;
+		this->trapoffset = (size_t)-1;
+		this->error = { STATUS_OK, 0 };
+		this->reporterrors = true;
+		this->memoize = true;
+		this->detectloops = false;
+		this->profile = nullptr;
+		this->io = { writestdout, readconsole, nullptr };
+		this->outputsize = 0;
+		this->outputlimit = OUTPUT_BUFFER_SIZE;
+		this->translatestats = xl_brainfuck_translate_stats();
+	}
+	// The destructor which frees the memory occupied by the tape.
+	~xl_brainfuck_env() {
+#if !defined(_WIN32)
+		if (this->tapefd >= 0 || this->sparsetape) {
+			munmap(this->tape, this->tapebytes);
+			if (this->tapefd >= 0) {
+				close(this->tapefd);
+			}
+			return;
+		}
+#endif
+		free(tape);
+	}
+
+	// Determines if the tape has been allocated, or mapped from its file.
+	bool isready() const {
+		return this->tape != nullptr;
+	}
+
+	// Interprets a block of brainfuck code which includes processing of memory units on the tape, reception of input and printing of output.
+	// Only valid brainfuck command characters will be interpreted, while all other characters will be ignored except the '\0' at the end of the code string.
+	// The code is compiled into bytecode before it is executed, see the execute method. Returns STATUS_OK or the status of the error which ended the execution.
+	int interpret(const char *code) {
+		xl_brainfuck_program program;
+		program.compile(code);
+		return this->execute(program);
+	}
+
+	// Executes a compiled block of brainfuck code.
+	// Validity of the pointer's address will be checked, where the interpreter will terminate and report an error if the ptr attempting to read or write a value is beyond the space defined by minaddr and maxaddr. The error reports the source offset of the offending command.
+	// The output is buffered and written to the output channel before any input is read and when the execution ends.
+	// If the pointer is proved to stay within the tape from its current position, see the bounds method of the program, the code is executed without any checks. Otherwise, on a circular tape, the pointer is wrapped around the ends of the tape rather than checked, see the setcircular method.
+	// The quotas, if any, are enforced during the execution. Returns STATUS_OK or the status of the error which ended the execution, which is also kept for the geterror method.
+	// An execution restored from a checkpoint is resumed by passing the bytecode offset of the checkpoint, from which the code is executed with bounds checks. So is a paused execution, see the setstop and setwatchpoint methods and the breakpoints of the program.
+	int execute(const xl_brainfuck_program &program, size_t bytecodeoffset = 0) {
+		this->error = { STATUS_OK, 0 };
+		this->resumeoffset = 0;
+		this->executionstart = std::chrono::steady_clock::now();
+		ptrdiff_t minoffset = 0;
+		ptrdiff_t maxoffset = 0;
+		const bool ischecked = bytecodeoffset != 0 || !program.bounds(&minoffset, &maxoffset) ||
+			this->ptr - this->minaddr < -minoffset || this->maxaddr - this->ptr < maxoffset;
+		const bool isbudgeted = this->quota.steps != 0 || this->quota.seconds != 0 || this->checkpointer.save != nullptr || this->stopstep != 0 || this->tapefd >= 0;
+		if (this->wrapmask != 0) {
+			this->wrapptr();
+		}
+		if (this->checkpointer.save != nullptr) {
+			this->nextcheckpoint = this->executionstart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::duration<double>(this->checkpointer.interval));
+		}
+		const int result = this->profile != nullptr ?
+			this->executeselected<true>(program, bytecodeoffset, ischecked, isbudgeted) :
+			this->executeselected<false>(program, bytecodeoffset, ischecked, isbudgeted);
+		this->usage.steps += (unsigned long long)(this->budgetgrant - this->budget);
+		this->budgetgrant = this->budget;
+		this->usage.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - this->executionstart).count();
+		this->flushoutput();
+		return result;
+	}
+
+	// Sets the profile into which subsequent executions are recorded, or disables profiling if the profile is nullptr.
+	// Loop memoization is suspended while profiling, so that the trip count of every loop is observed.
+	void setprofile(xl_brainfuck_profile *profile) {
+		this->profile = profile;
+	}
+
+	// Sets the resource quotas of the brainfuck environment and clears the resources used so far.
+	// A tape page quota moves the end of the addressable tape closer to its start, so that the pointer cannot reach more pages than allowed. The pages are counted from the first cell of the tape, including any cells left of the origin.
+	void setquota(const xl_brainfuck_quota &quota) {
+		this->quota = quota;
+		this->usage = xl_brainfuck_usage();
+		this->limittape();
+		this->budget = this->refillbudget();
+		this->outputlimit = quota.outputbytes != 0 ? std::min(OUTPUT_BUFFER_SIZE, quota.outputbytes) : OUTPUT_BUFFER_SIZE;
+	}
+
+	// Sets the origin of the tape as an offset in cells from its first cell, and moves the pointer to the origin. Returns false if the offset is beyond the tape.
+	// The pointer may move up to that many cells left of its start, and returns to the origin when the environment is reset. Offsets of cells, as in the states of executions and the watchpoints, remain counted from the first cell of the tape.
+	bool setorigin(size_t celloffset) {
+		if (celloffset > (size_t)(this->tapeend - this->minaddr)) {
+			return false;
+		}
+		this->origin = celloffset;
+		this->ptr = this->minaddr + celloffset;
+		return true;
+	}
+
+	// Makes the tape circular or not, and returns false if the tape cannot be made circular because its size is not a power of two of at least two cells.
+	// On a circular tape, the pointer wraps around to the other end of the tape where it would leave the tape, and no access violation occurs. If the pages of the tape are limited by a quota, the pointer wraps within the largest power of two of cells that the quota allows.
+	bool setcircular(bool enabled) {
+		const size_t tapesize = (size_t)(this->tapeend - this->minaddr + 1);
+		if (enabled && (tapesize < 2 || (tapesize & (tapesize - 1)) != 0)) {
+			return false;
+		}
+		this->circular = enabled;
+		this->limittape();
+		return true;
+	}
+
+	// Sets the handler which receives the state of subsequent executions at checkpoints, or disables checkpoints if its save function is nullptr.
+	// The output is flushed before each checkpoint, so that the state accounts for all output written. No checkpoints are taken while profiling, as the state of the profile cannot be resumed.
+	void setcheckpointer(const xl_brainfuck_checkpointer<storage_t> &checkpointer) {
+		this->checkpointer = checkpointer;
+	}
+
+	// Restores the tape, the pointer and the resources used from the state of a checkpoint, after which the same program is executed from the bytecode offset of the state to resume the execution.
+	// Returns false if the state does not fit the tape of the environment.
+	bool restore(const xl_brainfuck_state<storage_t> &state) {
+		if (state.tapesize != (size_t)(this->tapeend - this->minaddr + 1) || state.ptroffset >= state.tapesize) {
+			return false;
+		}
+		this->copytape(state.tape, state.tapesize);
+		this->ptr = this->minaddr + state.ptroffset;
+		this->usage = state.usage;
+		this->resumeoffset = state.bytecodeoffset;
+		this->trapoffset = (size_t)-1;
+		this->budget = this->refillbudget();
+		return true;
+	}
+
+	// Returns the current state of the environment, whose bytecode offset is where the latest execution resumes if it paused, and zero otherwise.
+	xl_brainfuck_state<storage_t> getstate() {
+		return { this->minaddr, (size_t)(this->tapeend - this->minaddr + 1), (size_t)(this->ptr - this->minaddr), this->resumeoffset, this->usage };
+	}
+
+	// Pauses subsequent executions at the first trip of a loop at which the steps used reach the given step, or lets them run on if the step is zero.
+	// A paused execution returns STATUS_PAUSED, and resumes when the same program is executed from the bytecode offset of the state, see the getstate method. As a memoized loop skips the steps of its trips, the steps only identify the same point of an execution across runs while memoization is disabled.
+	void setstop(unsigned long long step) {
+		this->stopstep = step;
+		this->budget = this->refillbudget();
+	}
+
+	// Sets or clears a watchpoint on the cell at the offset from the start of the tape, which pauses subsequent executions right after an instruction writes the cell. Returns false if the offset lies beyond the tape.
+	// Executions with watchpoints run in an instantiation which compares the pointer against the watched cells at every write, and without memoization or specialized loops, which write cells without instructions. Executions without watchpoints run as fast as before.
+	bool setwatchpoint(size_t celloffset, bool enabled) {
+		if (celloffset > (size_t)(this->tapeend - this->minaddr)) {
+			return false;
+		}
+		auto watchfound = std::lower_bound(this->watchpoints.begin(), this->watchpoints.end(), celloffset);
+		const bool iswatched = watchfound != this->watchpoints.end() && *watchfound == celloffset;
+		if (enabled && !iswatched) {
+			this->watchpoints.insert(watchfound, celloffset);
+		} else if (!enabled && iswatched) {
+			this->watchpoints.erase(watchfound);
+		}
+		this->watchmin = this->watchpoints.empty() ? nullptr : this->minaddr + this->watchpoints.front();
+		this->watchmax = this->watchpoints.empty() ? nullptr : this->minaddr + this->watchpoints.back();
+		return true;
+	}
+
+	// Clears all watchpoints.
+	void clearwatchpoints() {
+		this->watchpoints.clear();
+		this->watchmin = this->watchmax = nullptr;
+	}
+
+	// Determines if the cell at the offset from the start of the tape is watched.
+	bool iswatchpoint(size_t celloffset) {
+		return std::binary_search(this->watchpoints.begin(), this->watchpoints.end(), celloffset);
+	}
+
+	// Returns the resources used since the quotas were last set, where the steps are counted only while a step or time quota is set, checkpoints are enabled or the tape is backed by a file.
+	xl_brainfuck_usage getusage() {
+		return this->usage;
+	}
+
+	// Returns the error which ended the latest execution, whose status is STATUS_OK if the execution succeeded.
+	xl_brainfuck_error geterror() {
+		return this->error;
+	}
+
+	// Enables or disables the error messages written to the output channel, which are enabled by default. The status of an error is returned regardless, and geterror returns it with its source offset.
+	// The messages count against the output quota like any other output, and a message which does not fit within the quota is dropped.
+	void setreporting(bool enabled) {
+		this->reporterrors = enabled;
+	}
+
+	// Sets the input and output channels of the brainfuck environment, which are the console by default.
+	void setio(const xl_brainfuck_io &io) {
+		this->io = io;
+	}
+
+	// Translates a block of brainfuck code into the C source code according to the specifications of the instantiated environment, which replaces the content of ccode.
+	// No syntax checking or boundary checking are performed. Nonetheless, the function returns 0 if the code does not have unenclosed loops, 1 if the code has unenclosed loops. The index of a circular tape wraps around its ends, see the setcircular method.
+	// If a profile of the code is supplied, the loops are translated with branch and unrolling hints drawn from it.
+	int translate(const char *bfcode, std::string &ccode, const xl_brainfuck_profile *profile = nullptr) {
+
+		// Determines string representing storage_t at compile time.
+		// The Boolean type is not supported and will be substituted with char type.
+		const char *DECLTYPE_STR = "";
+		if (std::is_same<storage_t, char>::value) {
+			DECLTYPE_STR = "char";
+		} else if (std::is_same<storage_t, unsigned char>::value) {
+			DECLTYPE_STR = "unsigned char";
+		} else if (std::is_same<storage_t, short>::value) {
+			DECLTYPE_STR = "short";
+		} else if (std::is_same<storage_t, unsigned short>::value) {
+			DECLTYPE_STR = "unsigned short";
+		} else if (std::is_same<storage_t, int>::value) {
+			DECLTYPE_STR = "int";
+		} else if (std::is_same<storage_t, unsigned>::value) {
+			DECLTYPE_STR = "unsigned";
+		} else if (std::is_same<storage_t, long>::value) {
+			DECLTYPE_STR = "long";
+		} else if (std::is_same<storage_t, unsigned long>::value) {
+			DECLTYPE_STR = "unsigned long";
+		} else if (std::is_same<storage_t, long long>::value) {
+			DECLTYPE_STR = "long long";
+		} else if (std::is_same<storage_t, unsigned long long>::value) {
+			DECLTYPE_STR = "unsigned long long";
+		} else {
+			DECLTYPE_STR = "char";
+		}
+
+		ccode.clear();
+
+		// Hash-conses the loops of the code by their commands, so that loops repeated at several sites are translated once into a shared function.
+		std::unordered_map<const char *, sharedloop> sharedloops = this->findsharedloops(bfcode);
+		// Orders the shared functions by id so that any shared loop nested in another is defined before it is called.
+		std::vector<const char *> sharedfunctions;
+		for (const auto &shared : sharedloops) {
+			if (shared.first == shared.second.representative) {
+				sharedfunctions.push_back(shared.first);
+			}
+		}
+		std::sort(sharedfunctions.begin(), sharedfunctions.end(), [&](const char *a, const char *b) {
+			return sharedloops.at(a).id < sharedloops.at(b).id;
+		});
+
+		// Prints code to the ccode str, which grows as each statement is appended to it.
+		// Prints header inclusions.
+		// The code depends on the conio.h header which is not part of the ANSI C standard.
+		appendformat(ccode, "#include <stdio.h>\n");
+		appendformat(ccode, "#include <stdlib.h>\n");
+		appendformat(ccode, "#include <stddef.h>\n");
+		appendformat(ccode, "#include \"conio.h\"\n");
+		appendformat(ccode, "\n");
+
+		// Prints the macros of the branch hints used by profiled loops.
+		if (profile != nullptr) {
+			appendformat(ccode, "#if defined(__GNUC__)\n");
+			appendformat(ccode, "#define LIKELY(condition) __builtin_expect(!!(condition), 1)\n");
+			appendformat(ccode, "#define UNLIKELY(condition) __builtin_expect(!!(condition), 0)\n");
+			appendformat(ccode, "#else\n");
+			appendformat(ccode, "#define LIKELY(condition) (condition)\n");
+			appendformat(ccode, "#define UNLIKELY(condition) (condition)\n");
+			appendformat(ccode, "#endif\n");
+			appendformat(ccode, "\n");
+		}
+
+		// Prints the tape and the pointer at file scope so that they are visible to the shared functions.
+		appendformat(ccode, "static %s *tape;\n", DECLTYPE_STR);
+		appendformat(ccode, "static ptrdiff_t i;\n");
+		appendformat(ccode, "\n");
+
+		// Prints the shared functions, each consisting of a single loop.
+		for (const char *loopstart : sharedfunctions) {
+			const sharedloop &shared = sharedloops.at(loopstart);
+			int functionindentlevel = 0;
+			appendformat(ccode, "static void loop%u(void) {\n", (unsigned)shared.id);
+			functionindentlevel++;
+			this->translateloophead(ccode, functionindentlevel, profile == nullptr ? nullptr : profile->findloop(loopstart - bfcode));
+			functionindentlevel++;
+			this->translateblock(loopstart + 1, shared.loopend, ccode, functionindentlevel, sharedloops, bfcode, profile);
+			appendformat(ccode, "\t}\n");
+			appendformat(ccode, "}\n");
+			appendformat(ccode, "\n");
+		}
+		
+		// Prints the preparative codes of the program according to the configurations of the xl_brainfuck_env instance.
+		// Stores the current level of indentation, which shall be incremented or decremented when a nested block is entered or exited.
+		int indentlevel = 0;
+
+		for (int i = 0; i < indentlevel; i++) {
+			appendformat(ccode, "\t");
+		}
+		appendformat(ccode, "int main() {\n");
+		indentlevel++;
+		for (int i = 0; i < indentlevel; i++) {
+			appendformat(ccode, "\t");
+		}
+		appendformat(ccode, "\n");
+		for (int i = 0; i < indentlevel; i++) {
+			appendformat(ccode, "\t");
+		}
+		appendformat(ccode, "tape = (%s *)calloc(%llu, sizeof(%s));\n",
+			DECLTYPE_STR, (unsigned long long)(this->tapeend - this->minaddr + 1), DECLTYPE_STR);
+		// Starts the index at the origin of the tape, if it is not the first cell.
+		if (this->origin != 0) {
+			for (int i = 0; i < indentlevel; i++) {
+				appendformat(ccode, "\t");
+			}
+			appendformat(ccode, "i = %llu;\n", (unsigned long long)this->origin);
+		}
+		appendformat(ccode, "\n");
+
+		// Translates brainfuck codes to C code.
+		// Consecutive + and -, as well as > and <, will be congealed into a single C statement.
+		this->translateblock(bfcode, bfcode + strlen(bfcode), ccode, indentlevel, sharedloops, bfcode, profile);
+
+		// Appends the ending for the C program.
+		for (int i = 0; i < indentlevel; i++) {
+			appendformat(ccode, "\t");
+		}
+		appendformat(ccode, "\n");
+		for (int i = 0; i < indentlevel; i++) {
+			appendformat(ccode, "\t");
+		}
+		appendformat(ccode, "free(tape);\n");
+		for (int i = 0; i < indentlevel; i++) {
+			appendformat(ccode, "\t");
+		}
+		appendformat(ccode, "_getch();\n");
+		for (int i = 0; i < indentlevel; i++) {
+			appendformat(ccode, "\t");
+		}
+		appendformat(ccode, "\n");
+		for (int i = 0; i < indentlevel; i++) {
+			appendformat(ccode, "\t");
+		}
+		appendformat(ccode, "return 0;\n");
+		for (int i = 0; i < indentlevel; i++) {
+			appendformat(ccode, "\t");
+		}
+		appendformat(ccode, "\n");
+		indentlevel--;
+		for (int i = 0; i < indentlevel; i++) {
+			appendformat(ccode, "\t");
+		}
+		appendformat(ccode, "}\n");
+
+		// Assess if there is any errors in the indentation, i.e. errors with unenclosed loops.
+		return indentlevel == 0 ? 0 : 1;
+
+	}
+
+	// Returns the statistics of the latest call of the translate method.
+	xl_brainfuck_translate_stats gettranslatestats() {
+		return this->translatestats;
+	}
+
+	// Manually resets the internal state of the brainfuck environment, where all storage units will be reinitialized to zero and the pointer to the origin of the tape, which is the start position of the memory block unless set otherwise.
+	void reset() {
+		// A tape file is emptied by truncating it, which keeps it sparse.
+#if !defined(_WIN32)
+		if (this->tapefd >= 0 && ftruncate(this->tapefd, 0) == 0 && ftruncate(this->tapefd, (off_t)this->tapebytes) == 0) {
+			this->ptr = this->minaddr + this->origin;
+			return;
+		}
+#endif
+		this->clearcells((char *)this->minaddr, (size_t)(this->tapeend - this->minaddr + 1) * sizeof(storage_t));
+		this->ptr = this->minaddr + this->origin;
+	}
+
+	// Enables or disables the adaptive loop memoization of the interpret method.
+	void setmemoization(bool enabled) {
+		this->memoize = enabled;
+	}
+
+	// Determines if the adaptive loop memoization is enabled.
+	bool getmemoization() const {
+		return this->memoize;
+	}
+
+	// Enables or disables the detection of infinite loops at run time, which is disabled by default.
+	// A pure loop depends only on the cells in its window, hence it never ends if the window returns to a state it has been in at the end of an earlier trip. The window is compared periodically, which costs a counter per trip of a pure loop.
+	// Loops which never change their cell are detected at compile time and reported regardless of this setting.
+	void setloopdetection(bool enabled) {
+		this->detectloops = enabled;
+	}
+
+	// Determines if the current pointer position is out of range.
+	bool ptroutofrange() {
+		return this->ptr < this->minaddr || this->ptr > this->maxaddr;
+	}
+
+private:
+
+	// Prints the head of a loop at the given level of indentation.
+	// If the loop has been profiled, its condition is marked as likely or unlikely by the direction the branch mostly took, and a loop which always ran the same small number of times is marked for unrolling.
+	void translateloophead(std::string &ccode, int indentlevel, const xl_brainfuck_loopprofile *loopprofile) {
+		const char *condition = "tape[i] != 0";
+		if (loopprofile != nullptr) {
+			const unsigned long long evaluations = loopprofile->entries + loopprofile->iterations;
+			if (loopprofile->iterations * 100 >= evaluations * PROFILE_LIKELY_PERCENT) {
+				condition = "LIKELY(tape[i] != 0)";
+			} else if (loopprofile->iterations * 100 <= evaluations * PROFILE_UNLIKELY_PERCENT) {
+				condition = "UNLIKELY(tape[i] != 0)";
+			}
+			if (loopprofile->mintrip == loopprofile->maxtrip &&
+				loopprofile->maxtrip > 1 && loopprofile->maxtrip <= PROFILE_UNROLL_MAX_TRIP) {
+				appendformat(ccode, "#if defined(__GNUC__)\n#pragma GCC unroll %u\n#endif\n", (unsigned)loopprofile->maxtrip);
+			}
+		}
+		for (int i = 0; i < indentlevel; i++) {
+			appendformat(ccode, "\t");
+		}
+		appendformat(ccode, "while (%s) {\n", condition);
+	}
+
+	// Translates the brainfuck code from bfbegin to bfend into C statements at the given level of indentation.
+	// Loops found in sharedloops are translated as calls to their shared functions, and loops found in the profile, if any, are translated with the hints drawn from their profile.
+	void translateblock(const char *bfbegin, const char *bfend, std::string &ccode, int &indentlevel,
+		const std::unordered_map<const char *, sharedloop> &sharedloops, const char *bfcode, const xl_brainfuck_profile *profile) {
+
+		const char *bfptr = bfbegin;
+
+		// Consecutive + and -, as well as > and <, will be congealed into a single C statement.
+		while (bfptr < bfend) {
+
+			switch (*bfptr) {
+
+			case '>': case '<': {
+
+				storage_t totaloffset = 0;
+
+				const char *bfsearchptr = bfptr;
+				// Collates the total offset by consecutive > and < characters until an intervening character is reached.
+				while (bfsearchptr < bfend) {
+					if (*bfsearchptr == '>') {
+						totaloffset++;
+					} else if (*bfsearchptr == '<') {
+						totaloffset--;
+					} else {
+						break;
+					}
+					bfsearchptr++;
+				}
+				// Translates code only if total pointer offset is not zero.
+				for (int i = 0; i < indentlevel; i++) {
+					appendformat(ccode, "\t");
+				}
+				// The index of a circular tape is masked as it moves, so that it wraps around the ends of the tape.
+				if (totaloffset != 0 && this->circular) {
+					appendformat(ccode, totaloffset > 0 ? "i = (i + %d) & %llu;" : "i = (i - %d) & %llu;",
+						totaloffset > 0 ? (int)totaloffset : -(int)totaloffset, (unsigned long long)(this->tapeend - this->minaddr));
+				} else if (totaloffset > 0) {
+					if (totaloffset == 1) {
+						appendformat(ccode, "i++;");
+					}  else {
+						appendformat(ccode, "i += %d;", totaloffset);
+					}
+				} else if (totaloffset < 0) {
+					if (totaloffset == -1) {
+						appendformat(ccode, "i--;");
+					} else {
+						appendformat(ccode, "i -= %d;", -totaloffset);
+					}
+				}
+				// The brainfuck code usually consists of pairs of ptr movement and ptr value assignment characters. To improve readability, one pair of pointer movement and assignment characters will be put on the same line.
+				if (*bfsearchptr == '+' || *bfsearchptr == '-') {
+					appendformat(ccode, " ");
+				} else {
+					appendformat(ccode, "\n");
+				}
+				bfptr = bfsearchptr;
+				break;
+			}
+
+			case '+': case '-': {
+
+				storage_t totalchange = 0;
+
+				const char *bfsearchptr = bfptr;
+				// Collates the total change by consecutive + and - characters until an intervening character is reached.
+				while (bfsearchptr < bfend) {
+					if (*bfsearchptr == '+') {
+						totalchange++;
+					} else if (*bfsearchptr == '-') {
+						totalchange--;
+					} else {
+						break;
+					}
+					bfsearchptr++;
+				}
+				// Translates code only if total change is not zero.
+				// Determines if the value assignment statement is preceded by a pointer movement statement, if yes, no indentation is printed into the C code string.
+				if (bfptr == bfbegin ||
+					(bfptr[-1] != '>' && bfptr[-1] != '<')) {
+					for (int i = 0; i < indentlevel; i++) {
+						appendformat(ccode, "\t");
+					}
+				}
+				if (totalchange > 0) {
+					if (totalchange == 1) {
+						appendformat(ccode, "tape[i]++;\n");
+					} else {
+						appendformat(ccode, "tape[i] += %d;\n", totalchange);
+					}
+				} else if (totalchange < 0) {
+					if (totalchange == -1) {
+						appendformat(ccode, "tape[i]--;\n");
+					} else {
+						appendformat(ccode, "tape[i] -= %d;\n", -totalchange);
+					}
+				}
+				bfptr = bfsearchptr;
+				break;
+			}
+
+			case '.': {
+				for (int i = 0; i < indentlevel; i++) {
+					appendformat(ccode, "\t");
+				}
+				ccode += "printf(\"%%c\", tape[i]);\n";
+				bfptr++;
+				break;
+			}
+
+			case ',': {
+				for (int i = 0; i < indentlevel; i++) {
+					appendformat(ccode, "\t");
+				}
+				appendformat(ccode, "tape[i] = _getch();\n");
+				bfptr++;
+				break;
+			}
+
+			case '[': {
+				// A loop shared with other sites is translated as a call to its function.
+				auto sharedfound = sharedloops.find(bfptr);
+				if (sharedfound != sharedloops.end()) {
+					for (int i = 0; i < indentlevel; i++) {
+						appendformat(ccode, "\t");
+					}
+					appendformat(ccode, "loop%u();\n", (unsigned)sharedfound->second.id);
+					bfptr = sharedfound->second.loopend + 1;
+					break;
+				}
+				this->translateloophead(ccode, indentlevel, profile == nullptr ? nullptr : profile->findloop(bfptr - bfcode));
+				indentlevel++;
+				bfptr++;
+				break;
+			}
+
+			case ']': {
+				indentlevel--;
+				for (int i = 0; i < indentlevel; i++) {
+					appendformat(ccode, "\t");
+				}
+				appendformat(ccode, "}\n");
+				bfptr++;
+				break;
+			}
+
+			default: {
+				bfptr++;
+			}
+
+			}
+
+		}
+
+	}
+
+	// Selects the instantiation of executebytecode for the bounds checks, the quotas and the watchpoints of an execution.
+	// Watchpoints are rare enough to be checked in the instantiations with bounds checks or masks only, and are ignored while profiling.
+	// A circular tape masks the pointer in place of the bounds checks.
+	template<bool PROFILE>
+	int executeselected(const xl_brainfuck_program &program, size_t bytecodeoffset, bool ischecked, bool isbudgeted) {
+		const bool iswrapped = ischecked && this->wrapmask != 0;
+		if (!PROFILE && !this->watchpoints.empty()) {
+			if (iswrapped) {
+				return isbudgeted ?
+					this->executebytecode<false, false, true, true, true>(program, bytecodeoffset) :
+					this->executebytecode<false, false, false, true, true>(program, bytecodeoffset);
+			}
+			return isbudgeted ?
+				this->executebytecode<false, true, true, true, false>(program, bytecodeoffset) :
+				this->executebytecode<false, true, false, true, false>(program, bytecodeoffset);
+		}
+		if (iswrapped) {
+			return isbudgeted ?
+				this->executebytecode<PROFILE, false, true, false, true>(program, bytecodeoffset) :
+				this->executebytecode<PROFILE, false, false, false, true>(program, bytecodeoffset);
+		}
+		if (ischecked) {
+			return isbudgeted ?
+				this->executebytecode<PROFILE, true, true, false, false>(program, bytecodeoffset) :
+				this->executebytecode<PROFILE, true, false, false, false>(program, bytecodeoffset);
+		}
+		return isbudgeted ?
+			this->executebytecode<PROFILE, false, true, false, false>(program, bytecodeoffset) :
+			this->executebytecode<PROFILE, false, false, false, false>(program, bytecodeoffset);
+	}
+
+	// Runs the bytecode of a compiled block of brainfuck code, see the execute method.
+	// The profiling code, the bounds checks, the budget of trips between checks of the quotas and checkpoints, the watchpoints and the masks of a circular tape are compiled into separate instantiations, so that each costs nothing when it is not needed.
+	// The checks at the trips of loops pass the instruction at which the execution continues, where a checkpoint may resume it.
+	// A breakpoint pauses the execution before its instruction, unless the execution resumes there, in which case the original instruction is dispatched.
+	template<bool PROFILE, bool CHECKED, bool BUDGETED, bool WATCHED, bool WRAPPED>
+	XLBF_NOINLINE
+	int executebytecode(const xl_brainfuck_program &program, size_t bytecodeoffset) {
+
+		const unsigned char *bytecode = program.bytecode.data();
+		const unsigned char *pc = bytecode + bytecodeoffset;
+		const unsigned char *oppc = pc;
+		const unsigned char *resumetrap = bytecodeoffset == this->trapoffset ? pc : nullptr;
+		this->trapoffset = (size_t)-1;
+
+		// The memoization state of the memoizable loops, and the stack of loops whose result is being recorded.
+		std::vector<memoloop> memoloops(program.loops.size());
+		std::vector<memopending> memostack;
+
+		// The number of steps taken by the previous trip of each scan.
+		std::vector<size_t> scantrips(program.scans);
+
+		// The loops being run while profiling, innermost last.
+		std::vector<profileactivation> profilestack;
+
+		// The budget is counted down in a local copy, which the compiler can keep in a register, and which is written back around the checks of the quotas and on return.
+		localbudget budget = { BUDGETED ? &this->budget : nullptr, this->budget };
+
+		while (true) {
+
+			oppc = pc;
+			unsigned char opcode = *pc++;
+
+		dispatch:
+			switch (opcode) {
+
+			case OP_END: {
+				return STATUS_OK;
+			}
+
+			case OP_ADD: {
+				if (CHECKED && this->ptroutofrange()) {
+					return this->reportaccess(program.sourceoffset(oppc - bytecode), true);
+				}
+				*this->ptr += (storage_t)readsignedvarint(&pc);
+				if (PROFILE) {
+					this->profile->recordcell((long long)*this->ptr);
+				}
+				if (WATCHED && this->iswatched()) {
+					return this->pause(program, oppc, pc);
+				}
+				break;
+			}
+
+			case OP_MOVE: {
+				this->ptr += (ptrdiff_t)readsignedvarint(&pc);
+				if (WRAPPED) {
+					this->wrapptr();
+				}
+				break;
+			}
+
+			case OP_OUTPUT: {
+				if (CHECKED && this->ptroutofrange()) {
+					return this->reportaccess(program.sourceoffset(oppc - bytecode), false);
+				}
+				if (!this->outputcell()) {
+					return this->reportoutputquota(program.sourceoffset(oppc - bytecode));
+				}
+				break;
+			}
+
+			// An additional instruction that prints out the numerical value instead of the character that the ptr points to.
+			case OP_OUTPUTNUM: {
+				if (CHECKED && this->ptroutofrange()) {
+					return this->reportaccess(program.sourceoffset(oppc - bytecode), false);
+				}
+				if (!this->outputcellnumber()) {
+					return this->reportoutputquota(program.sourceoffset(oppc - bytecode));
+				}
+				break;
+			}
+
+			case OP_INPUT: {
+				if (CHECKED && this->ptroutofrange()) {
+					return this->reportaccess(program.sourceoffset(oppc - bytecode), true);
+				}
+				// Flushes the output before blocking on input, so that any prompt is visible, and checks the quotas, as the input may have taken a while.
+				this->flushoutput();
+				if (BUDGETED) {
+					const int status = this->checkquota(program, oppc, nullptr, budget);
+					if (status != STATUS_OK) {
+						return status;
+					}
+				}
+				const int input = this->io.read(this->io.context);
+				if (input != EOF) {
+					this->usage.inputbytes++;
+					*(this->ptr) = (storage_t)input;
+					if (PROFILE) {
+						this->profile->recordcell((long long)*this->ptr);
+					}
+					if (WATCHED && this->iswatched()) {
+						return this->pause(program, oppc, pc);
+					}
+				}
+				break;
+			}
+
+			case OP_LOOPBEGIN: {
+				if (CHECKED && this->ptroutofrange()) {
+					return this->reportaccess(program.sourceoffset(oppc - bytecode), false);
+				}
+				const unsigned long long jump = readvarint(&pc);
+				if (PROFILE) {
+					this->profileloopbegin(program.sourceoffset(oppc - bytecode), profilestack);
+				}
+				if (*this->ptr == 0) {
+					pc += jump;
+				}
+				break;
+			}
+
+			case OP_LOOPEND: {
+				if (CHECKED && this->ptroutofrange()) {
+					return this->reportaccess(program.sourceoffset(oppc - bytecode), false);
+				}
+				const unsigned char *jumpbase = pc;
+				const unsigned long long jump = readvarint(&pc);
+				if (PROFILE) {
+					this->profileloopend(profilestack);
+				}
+				if (*this->ptr != 0) {
+					pc = jumpbase - jump;
+					if (BUDGETED && --budget.value <= 0) {
+						const int status = this->checkquota(program, oppc, PROFILE ? nullptr : pc, budget);
+						if (status != STATUS_OK) {
+							return status;
+						}
+					}
+				}
+				break;
+			}
+
+			case OP_MEMOBEGIN: {
+				if (CHECKED && this->ptroutofrange()) {
+					return this->reportaccess(program.sourceoffset(oppc - bytecode), false);
+				}
+				const unsigned long long jump = readvarint(&pc);
+				const size_t loopindex = (size_t)readvarint(&pc);
+				if (PROFILE) {
+					this->profileloopbegin(program.sourceoffset(oppc - bytecode), profilestack);
+				}
+				if (*this->ptr == 0) {
+					pc += jump;
+					break;
+				}
+				const xl_brainfuck_loopinfo &loopinfo = program.loops[loopindex];
+				memoloop &loop = memoloops[loopindex];
+				if (this->detectloops) {
+					loop.trips = 0;
+					loop.nextsnapshot = LOOP_CHECK_INTERVAL;
+					loop.snapshot.clear();
+				}
+				// A cache hit would pass over the breakpoints and watchpoints in the loop.
+				if (PROFILE || WATCHED || !this->memoize || !loopinfo.memoizable || loop.disabled || !program.traps.empty() ||
+					this->ptr + loopinfo.windowmin < this->minaddr || this->ptr + loopinfo.windowmax > this->maxaddr) {
+					break;
+				}
+				// The loop is entered afresh, hence the cache is probed with the window on entry.
+				std::vector<storage_t> window(this->ptr + loopinfo.windowmin, this->ptr + loopinfo.windowmax + 1);
+				loop.probes++;
+				auto resultfound = loop.cache.find(window);
+				if (resultfound != loop.cache.end()) {
+					loop.hits++;
+					memcpy(this->ptr + loopinfo.windowmin, resultfound->second.data(), window.size() * sizeof(storage_t));
+					pc += jump;
+					break;
+				}
+				if (loop.probes >= MEMO_WARMUP_PROBES && loop.hits * 100 < loop.probes * MEMO_MIN_HIT_PERCENT) {
+					// The hit rate does not justify the cache, hence memoization is abandoned for this loop.
+					loop.disabled = true;
+					loop.cache.clear();
+				} else {
+					memostack.push_back({ loopindex, std::move(window) });
+				}
+				break;
+			}
+
+			case OP_MEMOEND: {
+				if (CHECKED && this->ptroutofrange()) {
+					return this->reportaccess(program.sourceoffset(oppc - bytecode), false);
+				}
+				const unsigned char *jumpbase = pc;
+				const unsigned long long jump = readvarint(&pc);
+				const size_t loopindex = (size_t)readvarint(&pc);
+				if (PROFILE) {
+					this->profileloopend(profilestack);
+				}
+				if (*this->ptr != 0) {
+					pc = jumpbase - jump;
+					if (BUDGETED && --budget.value <= 0) {
+						const int status = this->checkquota(program, oppc, PROFILE ? nullptr : pc, budget);
+						if (status != STATUS_OK) {
+							return status;
+						}
+					}
+					if (this->detectloops && this->repeatsstate(program.loops[loopindex], memoloops[loopindex])) {
+						return this->report(STATUS_INFINITE_LOOP, program.sourceoffset(oppc - bytecode), "Infinite loop: the loop ending at offset %u returns to a state it has been in.");
+					}
+					break;
+				}
+				// The loop exits, hence its result is recorded if it missed the cache on entry.
+				if (!memostack.empty() && memostack.back().loopindex == loopindex) {
+					const xl_brainfuck_loopinfo &loopinfo = program.loops[loopindex];
+					memoloop &loop = memoloops[loopindex];
+					if (loop.cache.size() < MEMO_MAX_ENTRIES) {
+						loop.cache.emplace(std::move(memostack.back().window),
+							std::vector<storage_t>(this->ptr + loopinfo.windowmin, this->ptr + loopinfo.windowmax + 1));
+					}
+					memostack.pop_back();
+				}
+				break;
+			}
+
+			case OP_SCAN: {
+				if (CHECKED && this->ptroutofrange()) {
+					return this->reportaccess(program.sourceoffset(oppc - bytecode), false);
+				}
+				const ptrdiff_t stride = (ptrdiff_t)readsignedvarint(&pc);
+				const size_t scanindex = (size_t)readvarint(&pc);
+				if (*this->ptr == 0) {
+					if (PROFILE) {
+						this->profile->recordtrip(program.sourceoffset(oppc - bytecode), 0);
+					}
+					break;
+				}
+				// Scans without bounds checks as far as the stride keeps the pointer within the tape.
+				const size_t maxsteps = stride > 0 ? (this->maxaddr - this->ptr) / stride : (this->ptr - this->minaddr) / -stride;
+				const bool isnontemporal = scantrips[scanindex] * (stride > 0 ? stride : -stride) * sizeof(storage_t) > SCAN_LLC_SIZE;
+				const size_t steps = isnontemporal ? this->scan<true>(stride, maxsteps) : this->scan<false>(stride, maxsteps);
+				scantrips[scanindex] = steps;
+				if (PROFILE && steps <= maxsteps) {
+					this->profile->recordtrip(program.sourceoffset(oppc - bytecode), steps);
+				}
+				// On a circular tape, a scan which leaves the tape continues from the other end as another trip of the scan.
+				if (steps > maxsteps && !WRAPPED) {
+					return this->reportaccess(program.sourceoffset(oppc - bytecode), false);
+				}
+				if (steps > maxsteps) {
+					this->wrapptr();
+					pc = oppc;
+				}
+				if (BUDGETED && (budget.value -= (long long)steps) <= 0) {
+					const int status = this->checkquota(program, oppc, PROFILE ? nullptr : pc, budget);
+					if (status != STATUS_OK) {
+						return status;
+					}
+				}
+				break;
+			}
+
+			// Runs the specialized loop if the guards hold, which are that its window lies within the tape and that the loop cell reaches zero after exactly the speculated number of trips.
+			// The specialized loop is also skipped when its trips would cross a check of the quotas, or when the output is limited, so that the quotas are enforced by the generic loop.
+			// Otherwise, execution deoptimizes into the generic loop which follows, with the state untouched.
+			case OP_SPECTRIP: {
+				const unsigned long long trips = readvarint(&pc);
+				const storage_t celldelta = (storage_t)readsignedvarint(&pc);
+				const ptrdiff_t windowmin = (ptrdiff_t)readsignedvarint(&pc);
+				const ptrdiff_t windowmax = (ptrdiff_t)readsignedvarint(&pc);
+				const unsigned long long bodystart = readvarint(&pc);
+				const unsigned long long bodyend = readvarint(&pc);
+				const unsigned long long loopend = readvarint(&pc);
+				if (PROFILE || WATCHED || this->ptr + windowmin < this->minaddr || this->ptr + windowmax > this->maxaddr ||
+					(BUDGETED && budget.value <= (long long)trips) || this->quota.outputbytes != 0) {
+					break;
+				}
+				storage_t cell = *this->ptr;
+				unsigned long long trip = 0;
+				while (trip < trips && cell != 0) {
+					cell += celldelta;
+					trip++;
+				}
+				if (trip == trips && cell == 0) {
+					this->executeflat(pc + bodystart, pc + bodyend, trips);
+					// The generic loop takes one trip fewer back to its start than it runs its body.
+					if (BUDGETED) {
+						budget.value -= (long long)trips - 1;
+					}
+					pc += loopend;
+				}
+				break;
+			}
+
+			// Reports a loop which never changes its cell if it is entered, unless its window exceeds the tape, in which case the generic loop reports the access violation, or wraps around a circular tape, where its cell may be reached from the other end.
+			case OP_NOPROGRESS: {
+				const ptrdiff_t windowmin = (ptrdiff_t)readsignedvarint(&pc);
+				const ptrdiff_t windowmax = (ptrdiff_t)readsignedvarint(&pc);
+				if ((CHECKED || WRAPPED) && (this->ptr + windowmin < this->minaddr || this->ptr + windowmax > this->maxaddr)) {
+					break;
+				}
+				if (*this->ptr != 0) {
+					return this->report(STATUS_INFINITE_LOOP, program.sourceoffset(oppc - bytecode), "Infinite loop: the loop at offset %u never changes its cell.");
+				}
+				break;
+			}
+
+			case OP_UNMATCHEDBEGIN: {
+				if (CHECKED && this->ptroutofrange()) {
+					return this->reportaccess(program.sourceoffset(oppc - bytecode), false);
+				}
+				return this->report(STATUS_SYNTAX_ERROR, program.sourceoffset(oppc - bytecode), "Syntax error: unenclosed loop detected at offset %u. Missing ']'.");
+			}
+
+			case OP_UNMATCHEDEND: {
+				return this->report(STATUS_SYNTAX_ERROR, program.sourceoffset(oppc - bytecode), "Syntax error: unenclosed loop detected at offset %u. Missing '['.");
+			}
+
+			// Pauses at a breakpoint, or dispatches the original instruction, except for a specialized loop, which always deoptimizes into the generic loop.
+			case OP_TRAP: {
+				const xl_brainfuck_trap &trap = program.traps.find((size_t)(oppc - bytecode))->second;
+				if (trap.isbreakpoint && oppc != resumetrap) {
+					this->trapoffset = (size_t)(oppc - bytecode);
+					return this->pause(program, oppc, oppc);
+				}
+				resumetrap = nullptr;
+				if (trap.opcode == OP_SPECTRIP) {
+					pc = oppc + trap.size;
+					break;
+				}
+				opcode = trap.opcode;
+				goto dispatch;
+			}
+
+			}
+
+		}
+
+	}
+
+	// Records that the loop at the source offset is reached while profiling, where the loop is taken if the current cell is nonzero.
+	void profileloopbegin(size_t sourceoffset, std::vector<profileactivation> &profilestack) {
+		if (*this->ptr == 0) {
+			this->profile->recordtrip(sourceoffset, 0);
+		} else {
+			profilestack.push_back({ sourceoffset, 1 });
+		}
+	}
+
+	// Records that the innermost loop being profiled reaches its end, where the loop runs again if the current cell is nonzero.
+	void profileloopend(std::vector<profileactivation> &profilestack) {
+		if (*this->ptr != 0) {
+			profilestack.back().trips++;
+		} else {
+			this->profile->recordtrip(profilestack.back().sourceoffset, profilestack.back().trips);
+			profilestack.pop_back();
+		}
+	}
+
+	// Counts a trip of a pure loop, and determines every LOOP_CHECK_INTERVAL trips if its window is in the state of the latest snapshot.
+	// The snapshot is retaken whenever the trip count doubles, so that a cycle of any length is found within a few times its length after the loop enters it.
+	bool repeatsstate(const xl_brainfuck_loopinfo &loopinfo, memoloop &loop) {
+		loop.trips++;
+		if (loop.trips % LOOP_CHECK_INTERVAL != 0 ||
+			this->ptr + loopinfo.windowmin < this->minaddr || this->ptr + loopinfo.windowmax > this->maxaddr) {
+			return false;
+		}
+		const storage_t *window = this->ptr + loopinfo.windowmin;
+		const size_t windowsize = (size_t)(loopinfo.windowmax - loopinfo.windowmin + 1);
+		if (!loop.snapshot.empty() && memcmp(loop.snapshot.data(), window, windowsize * sizeof(storage_t)) == 0) {
+			return true;
+		}
+		if (loop.trips == loop.nextsnapshot) {
+			loop.snapshot.assign(window, window + windowsize);
+			loop.nextsnapshot *= 2;
+		}
+		return false;
+	}
+
+	// Buffers the character in the current cell for output, and returns false if the output quota leaves no room for it.
+	bool outputcell() {
+		if (this->outputsize == this->outputlimit && !this->makeroom(1)) {
+			return false;
+		}
+		this->outputbuffer[this->outputsize++] = (char)*this->ptr;
+		return true;
+	}
+
+	// Buffers the numerical value of the current cell for output, and returns false if the output quota leaves no room for it.
+	bool outputcellnumber() {
+		char number[24];
+		const int length = std::is_signed<storage_t>::value ?
+			snprintf(number, sizeof(number), "%lld", (long long)*this->ptr) :
+			snprintf(number, sizeof(number), "%llu", (unsigned long long)*this->ptr);
+		if (this->outputsize + length > this->outputlimit && !this->makeroom(length)) {
+			return false;
+		}
+		memcpy(this->outputbuffer + this->outputsize, number, length);
+		this->outputsize += length;
+		return true;
+	}
+
+	// Flushes the output buffer to make room for the number of bytes, and returns false if the output quota leaves no room for them.
+	XLBF_NOINLINE bool makeroom(size_t size) {
+		this->flushoutput();
+		this->outputlimit = OUTPUT_BUFFER_SIZE;
+		if (this->quota.outputbytes != 0) {
+			this->outputlimit = std::min(this->outputlimit, this->quota.outputbytes - this->usage.outputbytes);
+		}
+		return size <= this->outputlimit;
+	}
+
+	// Grants the budget of trips until the quotas are next checked, which ends the budget right after the step quota is used up, and right at the step at which the execution pauses.
+	long long refillbudget() {
+		long long grant = QUOTA_CHECK_INTERVAL;
+		if (this->quota.steps != 0) {
+			const unsigned long long remaining = this->usage.steps < this->quota.steps ? this->quota.steps - this->usage.steps : 0;
+			grant = (long long)std::min<unsigned long long>(grant, remaining + 1);
+		}
+		if (this->stopstep != 0) {
+			const unsigned long long remaining = this->usage.steps < this->stopstep ? this->stopstep - this->usage.steps : 1;
+			grant = (long long)std::min<unsigned long long>(grant, remaining);
+		}
+		this->budgetgrant = grant;
+		return grant;
+	}
+
+	// Charges the trips counted down by the local budget to the usage, checks the step and time quotas, and grants a new budget.
+	// Takes a checkpoint if one is due and the execution can resume at resumepc, which is nullptr where it cannot, and pauses there if the stop step is reached.
+	// Returns STATUS_OK, STATUS_PAUSED, or reports the quota exceeded at the instruction at oppc and returns its status.
+	XLBF_NOINLINE int checkquota(const xl_brainfuck_program &program, const unsigned char *oppc, const unsigned char *resumepc, localbudget &budget) {
+		this->usage.steps += (unsigned long long)(this->budgetgrant - budget.value);
+		budget.value = this->refillbudget();
+		if (this->quota.steps != 0 && this->usage.steps > this->quota.steps) {
+			return this->report(STATUS_STEP_QUOTA, program.sourceoffset(oppc - program.bytecode.data()), "Quota exceeded: the step limit was reached at offset %u.");
+		}
+		if (this->quota.seconds != 0 || this->checkpointer.save != nullptr) {
+			const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (this->quota.seconds != 0 &&
+				this->usage.seconds + std::chrono::duration<double>(now - this->executionstart).count() > this->quota.seconds) {
+				return this->report(STATUS_TIME_QUOTA, program.sourceoffset(oppc - program.bytecode.data()), "Quota exceeded: the time limit was reached at offset %u.");
+			}
+			if (this->checkpointer.save != nullptr && resumepc != nullptr && now >= this->nextcheckpoint) {
+				this->savecheckpoint((size_t)(resumepc - program.bytecode.data()), now);
+			}
+		}
+		if (this->tapefd >= 0) {
+			this->advisetape();
+		}
+		if (resumepc != nullptr && this->stopstep != 0 && this->usage.steps >= this->stopstep) {
+			return this->pause(program, oppc, resumepc);
+		}
+		return STATUS_OK;
+	}
+
+	// Moves the end of the addressable tape closer to its start as far as the page quota requires, and further to the largest power of two of cells if the tape is circular, which sets the mask of the pointer.
+	void limittape() {
+		this->maxaddr = this->tapeend;
+		if (this->quota.pages != 0) {
+			const size_t maxcells = this->quota.pages * QUOTA_PAGE_SIZE / sizeof(storage_t);
+			if (maxcells < (size_t)(this->tapeend - this->minaddr + 1)) {
+				this->maxaddr = this->minaddr + maxcells - 1;
+			}
+		}
+		this->wrapmask = 0;
+		if (this->circular) {
+			size_t ringsize = 1;
+			while (ringsize <= (size_t)(this->maxaddr - this->minaddr + 1) / 2) {
+				ringsize *= 2;
+			}
+			this->maxaddr = this->minaddr + ringsize - 1;
+			this->wrapmask = ringsize - 1;
+		}
+	}
+
+	// Wraps the pointer around the ends of a circular tape.
+	void wrapptr() {
+		this->ptr = this->minaddr + ((size_t)(this->ptr - this->minaddr) & this->wrapmask);
+	}
+
+	// Allocates a zero-initialized tape, mapped sparsely from anonymous memory if it is large enough, which is not reserved in the swap so that a tape may be far larger than the memory its clusters of cells take.
+	// The paging of the tape is left to the page table of the processor, hence a cell is accessed as in any other tape, and the existing checks of the bounds of the tape cover the pages as well.
+	storage_t *allocatetape(size_t tapesize) {
+#if !defined(_WIN32)
+		if (this->tapebytes >= TAPE_SPARSE_MIN_BYTES && this->tapebytes / sizeof(storage_t) == tapesize) {
+			int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(MAP_NORESERVE)
+			flags |= MAP_NORESERVE;
+#endif
+			void *mapping = mmap(nullptr, this->tapebytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+			if (mapping != MAP_FAILED) {
+				this->sparsetape = true;
+				return (storage_t *)mapping;
+			}
+		}
+#endif
+		return (storage_t *)calloc(tapesize, sizeof(storage_t));
+	}
+
+	// Hands the whole pages of a sparse tape in the range back to the kernel, after which they read as zero again, and returns false if they cannot be released.
+	bool releasepages(char *start, size_t bytes) {
+#if defined(__linux__)
+		return madvise(start, bytes, MADV_DONTNEED) == 0;
+#elif !defined(_WIN32)
+		return mmap(start, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED;
+#else
+		return false;
+#endif
+	}
+
+	// Zeroes the bytes of the tape in the range, releasing the whole pages within it if the tape is sparse.
+	void clearcells(char *start, size_t bytes) {
+		if (this->sparsetape) {
+			char *pagestart = this->tapepage(start + TAPE_PAGE_SIZE - 1);
+			char *pageend = this->tapepage(start + bytes);
+			if (pagestart < pageend && this->releasepages(pagestart, (size_t)(pageend - pagestart))) {
+				memset(start, 0, (size_t)(pagestart - start));
+				memset(pageend, 0, (size_t)(start + bytes - pageend));
+				return;
+			}
+		}
+		memset(start, 0, bytes);
+	}
+
+	// Returns the start of the page of the tape which holds the byte.
+	char *tapepage(char *byte) {
+		return (char *)this->tape + (size_t)(byte - (char *)this->tape) / TAPE_PAGE_SIZE * TAPE_PAGE_SIZE;
+	}
+
+	// Determines if all the bytes in the range are zero.
+	static bool iszero(const char *start, size_t bytes) {
+		return bytes == 0 || (start[0] == 0 && memcmp(start, start + 1, bytes - 1) == 0);
+	}
+
+	// Copies the cells of a state into the tape. A sparse tape is copied page by page, where the pages which are zero in the state are released, or left alone if they are untouched, rather than written, so that the tape stays as sparse as the state.
+	void copytape(const storage_t *source, size_t tapesize) {
+		char *target = (char *)this->minaddr;
+		const char *sourcebytes = (const char *)source;
+		const size_t bytes = tapesize * sizeof(storage_t);
+		if (!this->sparsetape) {
+			memcpy(target, sourcebytes, bytes);
+			return;
+		}
+		// Consecutive pages to be zeroed are released together.
+		size_t clearstart = 0;
+		size_t clearend = 0;
+		for (size_t offset = 0; offset < bytes; offset += TAPE_PAGE_SIZE) {
+			const size_t size = std::min(TAPE_PAGE_SIZE, bytes - offset);
+			const bool isclear = iszero(sourcebytes + offset, size);
+			if (isclear && !iszero(target + offset, size)) {
+				clearstart = clearend == offset ? clearstart : offset;
+				clearend = offset + size;
+				continue;
+			}
+			if (clearend > clearstart) {
+				this->clearcells(target + clearstart, clearend - clearstart);
+				clearstart = clearend = 0;
+			}
+			if (!isclear) {
+				memcpy(target + offset, sourcebytes + offset, size);
+			}
+		}
+		if (clearend > clearstart) {
+			this->clearcells(target + clearstart, clearend - clearstart);
+		}
+	}
+
+	// Maps a sparse file of the size of the tape at the path as the tape, and removes the file unless it is to be kept. Returns nullptr if the file cannot be created or mapped.
+	storage_t *maptape(const char *tapepath, bool keeptape) {
+#if defined(_WIN32)
+		return nullptr;
+#else
+		this->tapefd = open(tapepath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (this->tapefd < 0) {
+			return nullptr;
+		}
+		void *mapping = MAP_FAILED;
+		if (this->tapebytes != 0 && ftruncate(this->tapefd, (off_t)this->tapebytes) == 0) {
+			mapping = mmap(nullptr, this->tapebytes, PROT_READ | PROT_WRITE, MAP_SHARED, this->tapefd, 0);
+		}
+		if (!keeptape || mapping == MAP_FAILED) {
+			unlink(tapepath);
+		}
+		if (mapping == MAP_FAILED) {
+			close(this->tapefd);
+			this->tapefd = -1;
+			return nullptr;
+		}
+		return (storage_t *)mapping;
+#endif
+	}
+
+	// Advises the kernel on the access to the tape file by the direction in which the pointer has travelled since the latest advice. While the pointer keeps travelling the same way, the tape is read sequentially and the pages ahead of the pointer are read in advance, and otherwise the access is left to the default heuristics.
+	void advisetape() {
+#if !defined(_WIN32)
+		const ptrdiff_t movedbytes = (this->ptr - this->adviseptr) * (ptrdiff_t)sizeof(storage_t);
+		const int direction = movedbytes >= (ptrdiff_t)TAPE_ADVICE_MIN_BYTES ? 1 : movedbytes <= -(ptrdiff_t)TAPE_ADVICE_MIN_BYTES ? -1 : 0;
+		if (direction != this->advisedirection) {
+			madvise(this->tape, this->tapebytes, direction != 0 ? MADV_SEQUENTIAL : MADV_NORMAL);
+			this->advisedirection = direction;
+		}
+		if (direction != 0 && this->ptr >= this->tape && this->ptr <= this->tapeend) {
+			const size_t ptrpage = (size_t)((char *)this->ptr - (char *)this->tape) / TAPE_PAGE_SIZE * TAPE_PAGE_SIZE;
+			const size_t start = direction > 0 ? ptrpage : ptrpage - std::min(ptrpage, TAPE_ADVICE_AHEAD_BYTES);
+			const size_t end = direction > 0 ? std::min(this->tapebytes, ptrpage + TAPE_ADVICE_AHEAD_BYTES) : std::min(this->tapebytes, ptrpage + TAPE_PAGE_SIZE);
+			madvise((char *)this->tape + start, end - start, MADV_WILLNEED);
+		}
+		this->adviseptr = this->ptr;
+#endif
+	}
+
+	// Pauses the execution after the instruction at oppc, to be resumed at resumepc, and returns STATUS_PAUSED.
+	XLBF_NOINLINE int pause(const xl_brainfuck_program &program, const unsigned char *oppc, const unsigned char *resumepc) {
+		this->resumeoffset = (size_t)(resumepc - program.bytecode.data());
+		this->error = { STATUS_PAUSED, program.sourceoffset(oppc - program.bytecode.data()) };
+		return STATUS_PAUSED;
+	}
+
+	// Determines if the current cell is watched.
+	bool iswatched() {
+		return this->ptr >= this->watchmin && this->ptr <= this->watchmax &&
+			std::binary_search(this->watchpoints.begin(), this->watchpoints.end(), (size_t)(this->ptr - this->minaddr));
+	}
+
+	// Flushes the output and hands the state of the execution, which resumes at the bytecode offset, to the checkpointer.
+	// The next checkpoint is due an interval after the save function returns, so that slow saves do not dominate the execution.
+	void savecheckpoint(size_t bytecodeoffset, std::chrono::steady_clock::time_point now) {
+		this->flushoutput();
+		xl_brainfuck_usage usage = this->usage;
+		usage.seconds += std::chrono::duration<double>(now - this->executionstart).count();
+		this->checkpointer.save(this->checkpointer.context,
+			{ this->minaddr, (size_t)(this->tapeend - this->minaddr + 1), (size_t)(this->ptr - this->minaddr), bytecodeoffset, usage });
+		this->nextcheckpoint = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(this->checkpointer.interval));
+	}
+
+	// Runs the flat body of a loop from bodystart to bodyend the given number of times, without bounds checks or loop instructions.
+	// The body is trusted to stay within the tape, and consists only of additions, pointer movements and output.
+	void executeflat(const unsigned char *bodystart, const unsigned char *bodyend, unsigned long long trips) {
+		for (unsigned long long trip = 0; trip < trips; trip++) {
+			const unsigned char *pc = bodystart;
+			while (pc < bodyend) {
+				switch (*pc++) {
+				case OP_ADD: {
+					*this->ptr += (storage_t)readsignedvarint(&pc);
+					break;
+				}
+				case OP_MOVE: {
+					this->ptr += (ptrdiff_t)readsignedvarint(&pc);
+					break;
+				}
+				case OP_OUTPUT: {
+					this->outputcell();
+					break;
+				}
+				case OP_OUTPUTNUM: {
+					this->outputcellnumber();
+					break;
+				}
+				}
+			}
+		}
+	}
+
+	// Writes the buffered output to the output channel.
+	void flushoutput() {
+		if (this->outputsize > 0) {
+			this->io.write(this->io.context, this->outputbuffer, this->outputsize);
+			this->usage.outputbytes += this->outputsize;
+			this->outputsize = 0;
+		}
+	}
+
+	// Records the error at the source offset, and reports it through the output channel after the buffered output unless reporting is disabled.
+	// The message counts as output, and is dropped if the output quota leaves no room for the whole of it, so that the output never exceeds the quota.
+	// The format receives the source offset. Returns the status of the error.
+	XLBF_NOINLINE int report(xl_brainfuck_status status, size_t sourceoffset, const char *format) {
+		this->error = { status, sourceoffset };
+		if (this->reporterrors) {
+			char message[256];
+			const int length = snprintf(message, sizeof(message), format, (unsigned)sourceoffset);
+			const size_t messagesize = std::min<size_t>(length, sizeof(message) - 1);
+			this->flushoutput();
+			if (this->quota.outputbytes == 0 || this->usage.outputbytes + messagesize <= this->quota.outputbytes) {
+				this->io.write(this->io.context, message, messagesize);
+				this->usage.outputbytes += messagesize;
+			}
+		}
+		return status;
+	}
+
+	// Reports an access to the cell out of range at the source offset, which exceeds the tape page quota if the cell lies within the tape.
+	XLBF_NOINLINE int reportaccess(size_t sourceoffset, bool iswrite) {
+		if (this->ptr > this->maxaddr && this->ptr <= this->tapeend) {
+			return this->report(STATUS_MEMORY_QUOTA, sourceoffset, "Quota exceeded: the tape page limit was reached at offset %u.");
+		}
+		return this->report(STATUS_ACCESS_VIOLATION, sourceoffset, iswrite ?
+			"Access violation: attempt to write to an out-of-range address at offset %u." :
+			"Access violation: attempt to read from an out-of-range address at offset %u.");
+	}
+
+	// Reports that the output quota was used up at the source offset.
+	XLBF_NOINLINE int reportoutputquota(size_t sourceoffset) {
+		return this->report(STATUS_OUTPUT_QUOTA, sourceoffset, "Quota exceeded: the output limit was reached at offset %u.");
+	}
+
+	// Moves the pointer by the stride until it points to a zero cell, prefetching the cells ahead in the direction of the scan, and returns the number of steps taken.
+	// The pointer is trusted to stay within the tape for maxsteps steps. If no zero cell is found within those, the pointer is moved one more step out of the tape and maxsteps + 1 is returned.
+	template<bool NONTEMPORAL>
+	size_t scan(ptrdiff_t stride, size_t maxsteps) {
+		const ptrdiff_t stridebytes = stride * (ptrdiff_t)sizeof(storage_t);
+		const ptrdiff_t prefetchoffset = stride > 0 ? (ptrdiff_t)SCAN_PREFETCH_BYTES : -(ptrdiff_t)SCAN_PREFETCH_BYTES;
+		const size_t stepsperline = std::max<size_t>(1, CACHE_LINE_SIZE / (stridebytes > 0 ? stridebytes : -stridebytes));
+		const char *cellptr = (const char *)this->ptr;
+		size_t steps = 0;
+		size_t prefetchcountdown = 0;
+		while (steps < maxsteps) {
+			if (prefetchcountdown == 0) {
+				prefetch<NONTEMPORAL>(cellptr + prefetchoffset);
+				prefetchcountdown = stepsperline;
+			}
+			prefetchcountdown--;
+			cellptr += stridebytes;
+			steps++;
+			if (*(const storage_t *)cellptr == 0) {
+				this->ptr = (storage_t *)cellptr;
+				return steps;
+			}
+		}
+		this->ptr += stride * (ptrdiff_t)(maxsteps + 1);
+		return maxsteps + 1;
+	}
+
+	// Finds the loops of the code which occur at several sites with identical commands, and records the counts in translatestats.
+	// Miscellaneous characters are ignored when comparing loops, and loops nested in a shared loop are shared by its function rather than counted at each site.
+	std::unordered_map<const char *, sharedloop> findsharedloops(const char *bfcode) {
+		struct loopsite {
+			const char *loopstart;
+			const char *loopend;
+			std::string commands;
+		};
+		std::vector<loopsite> loopsites;
+		std::vector<size_t> openstack;
+		std::vector<std::string> commandstack(1);
+		for (const char *bfptr = bfcode; *bfptr != 0; bfptr++) {
+			if (strchr("+-<>.,[]", *bfptr) == nullptr) {
+				continue;
+			}
+			if (*bfptr == '[') {
+				openstack.push_back(loopsites.size());
+				loopsites.push_back({ bfptr, nullptr, std::string() });
+				commandstack.push_back(std::string());
+			}
+			commandstack.back().push_back(*bfptr);
+			if (*bfptr == ']' && !openstack.empty()) {
+				loopsite &site = loopsites[openstack.back()];
+				site.loopend = bfptr;
+				site.commands = std::move(commandstack.back());
+				commandstack.pop_back();
+				commandstack.back() += site.commands;
+				openstack.pop_back();
+			}
+		}
+
+		// Counts the sites of each distinct loop.
+		std::unordered_map<std::string, size_t> sitecounts;
+		for (const loopsite &site : loopsites) {
+			if (site.loopend != nullptr && site.commands.size() >= DEDUP_MIN_COMMANDS) {
+				sitecounts[site.commands]++;
+			}
+		}
+
+		// Assigns functions to repeated loops in order of length, and skips the sites nested in another shared site.
+		std::unordered_map<const char *, sharedloop> sharedloops;
+		std::unordered_map<std::string, const char *> representatives;
+		this->translatestats = xl_brainfuck_translate_stats();
+		const char *sharedend = nullptr;
+		for (const loopsite &site : loopsites) {
+			if (site.loopend == nullptr) {
+				continue;
+			}
+			this->translatestats.loopsites++;
+			auto countfound = sitecounts.find(site.commands);
+			if (countfound == sitecounts.end() || countfound->second < 2) {
+				continue;
+			}
+			auto representativefound = representatives.emplace(site.commands, site.loopstart).first;
+			sharedloops[site.loopstart] = { 0, site.loopend, representativefound->second };
+			if (sharedend == nullptr || site.loopstart > sharedend) {
+				sharedend = site.loopend;
+				this->translatestats.sharedsites++;
+			}
+		}
+		// A loop nested in another has fewer commands, hence ordering the ids by the number of commands lets each function call only functions defined before it.
+		std::vector<std::pair<size_t, const char *>> representativeorder;
+		for (const auto &representative : representatives) {
+			representativeorder.push_back({ representative.first.size(), representative.second });
+		}
+		std::sort(representativeorder.begin(), representativeorder.end());
+		for (size_t id = 0; id < representativeorder.size(); id++) {
+			sharedloops.at(representativeorder[id].second).id = id;
+		}
+		for (auto &shared : sharedloops) {
+			shared.second.id = sharedloops.at(shared.second.representative).id;
+		}
+		this->translatestats.sharedfunctions = representativeorder.size();
+		return sharedloops;
 	}
 
-	// Interprets a block of brainfuck code which includes processing of memory units on the tape, reception of input and printing of output.
-	// Only valid brainfuck command characters will be interpreted, while all other characters will be ignored except the '\0' at the end of the code string.
-	// Validity of the pointer's address will be checked, where the interpreter will terminate and print an error if the ptr attempting to read or write a value is beyond the space defined by minaddr and maxaddr.
-	int interpret(const char *code) {
+};
 
-		const char *codeptr = code;
 
-		while (*codeptr != 0) {
 
-			switch (*codeptr) {
+// The tiers of an xl_brainfuck_adaptiveprogram: the plain bytecode, the plain bytecode with the executions profiled, and the bytecode recompiled with speculative specializations from the profile.
+enum xl_brainfuck_tier {
+	TIER_BASELINE,
+	TIER_PROFILING,
+	TIER_SPECIALIZED
+};
 
-			case '>': {
-				this->ptr++;
-				codeptr++;
-				break;
-			}
+// The xl_brainfuck_adaptiveprogram class, which holds a block of brainfuck code that is executed many times, and chooses how to compile and execute it by a cost model so that its callers need not.
+// The code starts out as plain bytecode. Once the time spent in its executions shows that specializing it would save more than the profiled executions and the recompilation cost, its next executions are profiled, and the code is recompiled with the speculative specializations that the merged profile supports. A recompilation which specializes no loops, or whose executions turn out slower, is dropped for good, as is the whole process for code without any loops to specialize, so that small one-shot code never pays for more than its compilation.
+// The program may be executed by several threads at once, each on its own environment, which must not have a profile set. Executions always start from the beginning of the code.
+class xl_brainfuck_adaptiveprogram {
 
-			case '<': {
-				this->ptr--;
-				codeptr++;
-				break;
-			}
+	std::string code;
+	mutable std::mutex mutex;
+	std::shared_ptr<const xl_brainfuck_program> baseline;
+	std::shared_ptr<const xl_brainfuck_program> specialized;
+	int tier;
 
-			case '+': {
-				if (this->ptroutofrange()) {
-					printf("Access violation: attempt to write to an out-of-range address.");
-					return 1;
-				}
-				(*this->ptr)++;
-				codeptr++;
-				break;
-			}
+	// Whether the tier is final, and whether a thread is recompiling the code.
+	bool issettled;
+	bool iscompiling;
 
-			case '-': {
-				if (this->ptroutofrange()) {
-					printf("Access violation: attempt to write to an out-of-range address.");
-					return 1;
-				}
-				(*this->ptr)--;
-				codeptr++;
-				break;
-			}
+	// The time taken by the compilation of the code, the executions so far, and the time spent in the executions of each tier with the profile merged from the profiled executions.
+	double compileseconds;
+	unsigned long long runs;
+	unsigned long long baselineruns;
+	double baselineseconds;
+	unsigned long long specializedruns;
+	double specializedseconds;
+	unsigned long long profiledruns;
+	xl_brainfuck_profile profile;
 
-			case '.': {
-				if (this->ptroutofrange()) {
-					printf("Access violation: attempt to read from an out-of-range address.");
-					return 1;
+	// Records an execution of the tier which took the given time and was profiled into the profile, if any, and moves to the next tier if the cost model favours it.
+	// Every profiled execution is merged, whatever its status, as the trips of a loop are only recorded once the loop exits, hence an execution which ends early, such as by a quota, still profiles the loops it finished. Code which always ends early thus settles like any other once its profiled executions are recompiled.
+	// Returns true if the code is due to be recompiled with the profile.
+	bool record(int runtier, double seconds, const xl_brainfuck_profile *runprofile) {
+		this->runs++;
+		if (runtier == TIER_SPECIALIZED) {
+			this->specializedruns++;
+			this->specializedseconds += seconds;
+			if (!this->issettled && this->specializedruns >= ADAPTIVE_PROFILE_RUNS) {
+				this->issettled = true;
+				if (this->baselineruns != 0 && this->specializedseconds / this->specializedruns > ADAPTIVE_REVERT_MARGIN * this->baselineseconds / this->baselineruns) {
+					this->tier = TIER_BASELINE;
 				}
-				printf("%c", *this->ptr);
-				codeptr++;
-				break;
 			}
+			return false;
+		}
+		if (runtier == TIER_BASELINE) {
+			this->baselineruns++;
+			this->baselineseconds += seconds;
+		} else if (runprofile != nullptr) {
+			this->profile.merge(*runprofile);
+			this->profiledruns++;
+		}
+		// The executions to come are expected to take as long as those so far, of which specialization would save a fraction.
+		if (this->tier == TIER_BASELINE && !this->issettled && ADAPTIVE_EXPECTED_GAIN * this->baselineseconds >
+			(ADAPTIVE_PROFILE_OVERHEAD - 1) * ADAPTIVE_PROFILE_RUNS * this->baselineseconds / this->baselineruns + this->compileseconds) {
+			this->tier = TIER_PROFILING;
+		}
+		return this->tier == TIER_PROFILING && this->profiledruns >= ADAPTIVE_PROFILE_RUNS && !this->iscompiling;
+	}
 
-			// An additional character that prints out the numerical value instead of the character that the ptr points to.
-			case ':': {
-				if (this->ptroutofrange()) {
-					printf("Access violation: attempt to read from an out-of-range address.");
-					return 1;
-				}
-				printf("%d", *(this->ptr));
-				codeptr++;
-				break;
-			}
+public:
 
-			case ',': {
-				if (this->ptroutofrange()) {
-					printf("Access violation: attempt to write to an out-of-range address.");
-					return 1;
-				}
-				*(this->ptr) = _getch();
-				codeptr++;
-				break;
+	// Compiles the code, specialized by the profile of earlier executions if one is given.
+	xl_brainfuck_adaptiveprogram(const char *code, const xl_brainfuck_profile *profile = nullptr) :
+		code(code), tier(TIER_BASELINE), issettled(false), iscompiling(false), runs(0),
+		baselineruns(0), baselineseconds(0), specializedruns(0), specializedseconds(0), profiledruns(0) {
+		const auto start = std::chrono::steady_clock::now();
+		std::shared_ptr<xl_brainfuck_program> compiled = std::make_shared<xl_brainfuck_program>();
+		compiled->compile(code);
+		this->compileseconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		this->baseline = compiled;
+		size_t specializations = 0;
+		if (compiled->speculable(&specializations) == 0) {
+			this->issettled = true;
+		} else if (profile != nullptr) {
+			compiled = std::make_shared<xl_brainfuck_program>();
+			compiled->compile(code, profile);
+			compiled->speculable(&specializations);
+			this->issettled = specializations == 0;
+			if (specializations != 0) {
+				this->specialized = compiled;
+				this->tier = TIER_SPECIALIZED;
 			}
+		}
+	}
 
-			case '[': {
-				if (this->ptroutofrange()) {
-					printf("Access violation: attempt to read from an out-of-range address.");
-					return 1;
-				}
-				unsigned unsolvedloopcount = 1;
-				const char *codesearchptr = codeptr + 1;
-				bool hasloopmatch = false;
-				bool hasloopskip = false;
-				while (*codesearchptr != 0) {
-					if (*codesearchptr == '[') {
-						unsolvedloopcount++;
-					} else if (*codesearchptr == ']') {
-						unsolvedloopcount--;
-						if (unsolvedloopcount == 0) {
-							hasloopmatch = true;
-							hasloopskip = *this->ptr == 0;
-							break;
-						}
-					}
-					codesearchptr++;
-				}
-				if (!hasloopmatch) {
-					printf("Syntax error: unenclosed loop detected. Missing ']'.");
-					return 1;
-				}
-				if (hasloopskip) {
-					codeptr = codesearchptr + 1;
-				} else {
-					codeptr++;
-				}
-				break;
-			}
+	// Executes the code in the current tier on the brainfuck environment, and returns the status of the execution as the execute method of the environment does.
+	template<typename storage_t>
+	int execute(xl_brainfuck_env<storage_t> &env) {
+		std::unique_lock<std::mutex> lock(this->mutex);
+		const int runtier = this->tier;
+		const std::shared_ptr<const xl_brainfuck_program> program = runtier == TIER_SPECIALIZED ? this->specialized : this->baseline;
+		lock.unlock();
 
-			case ']': {
-				unsigned unsolvedloopcount = 1;
-				const char *codesearchptr = codeptr - 1;
-				bool hasloopmatch = false;
-				while (codesearchptr >= code) {
-					if (*codesearchptr == ']') {
-						unsolvedloopcount++;
-					} else if (*codesearchptr == '[') {
-						unsolvedloopcount--;
-						if (unsolvedloopcount == 0) {
-							hasloopmatch = true;
-							codeptr = codesearchptr;
-							break;
-						}
-					}
-					codesearchptr--;
-				}
-				if (!hasloopmatch) {
-					printf("Syntax error: unenclosed loop detected. Missing '['.");
-					return 1;
-				}
-				break;
-			}
-			
-			default: {
-				codeptr++;
-			}
+		xl_brainfuck_profile runprofile;
+		if (runtier == TIER_PROFILING) {
+			env.setprofile(&runprofile);
+		}
+		const auto start = std::chrono::steady_clock::now();
+		int status = STATUS_OK;
+		try {
+			status = env.execute(*program);
+		} catch (...) {
+			env.setprofile(nullptr);
+			throw;
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		env.setprofile(nullptr);
 
+		// Recompiles the code with the profile outside the lock, while the other executions go on in the current tier.
+		// A recompilation which throws clears the flag, so that a later execution compiles again.
+		lock.lock();
+		if (this->record(runtier, seconds, runtier == TIER_PROFILING ? &runprofile : nullptr)) {
+			const xl_brainfuck_profile mergedprofile = this->profile;
+			this->iscompiling = true;
+			lock.unlock();
+			std::shared_ptr<xl_brainfuck_program> compiled;
+			size_t specializations = 0;
+			try {
+				compiled = std::make_shared<xl_brainfuck_program>();
+				compiled->compile(this->code.c_str(), &mergedprofile);
+				compiled->speculable(&specializations);
+			} catch (...) {
+				lock.lock();
+				this->iscompiling = false;
+				throw;
+			}
+			lock.lock();
+			this->iscompiling = false;
+			if (specializations != 0) {
+				this->specialized = compiled;
+				this->tier = TIER_SPECIALIZED;
+			} else {
+				this->tier = TIER_BASELINE;
+				this->issettled = true;
 			}
-
 		}
+		return status;
+	}
 
-		return 0;
+	// Returns the current tier, see xl_brainfuck_tier.
+	int gettier() const {
+		std::lock_guard<std::mutex> lock(this->mutex);
+		return this->tier;
+	}
 
+	// Returns the number of executions so far.
+	unsigned long long getruns() const {
+		std::lock_guard<std::mutex> lock(this->mutex);
+		return this->runs;
 	}
 
-	// Translates a block of brainfuck code into the C source code according to the specifications of the instantiated environment.
-	// No syntax checking or boundary checking are performed. Nonetheless, the function returns 0 if the code does not have unenclosed loops, 1 if the code has unenclosed loops.
-	int translate(const char *bfcode, char *ccode) {
+	// Returns the size of the bytecode of the current tier in bytes.
+	size_t size() const {
+		std::lock_guard<std::mutex> lock(this->mutex);
+		return (this->tier == TIER_SPECIALIZED ? this->specialized : this->baseline)->size();
+	}
 
-		// Determines string representing storage_t at compile time.
-		// The Boolean type is not supported and will be substituted with char type.
-		const char *DECLTYPE_STR = "";
-		if (std::is_same<storage_t, char>::value) {
-			DECLTYPE_STR = "char";
-		} else if (std::is_same<storage_t, unsigned char>::value) {
-			DECLTYPE_STR = "unsigned char";
-		} else if (std::is_same<storage_t, short>::value) {
-			DECLTYPE_STR = "short";
-		} else if (std::is_same<storage_t, unsigned short>::value) {
-			DECLTYPE_STR = "unsigned short";
-		} else if (std::is_same<storage_t, int>::value) {
-			DECLTYPE_STR = "int";
-		} else if (std::is_same<storage_t, unsigned>::value) {
-			DECLTYPE_STR = "unsigned";
-		} else if (std::is_same<storage_t, long>::value) {
-			DECLTYPE_STR = "long";
-		} else if (std::is_same<storage_t, unsigned long>::value) {
-			DECLTYPE_STR = "unsigned long";
-		} else if (std::is_same<storage_t, long long>::value) {
-			DECLTYPE_STR = "long long";
-		} else if (std::is_same<storage_t, unsigned long long>::value) {
-			DECLTYPE_STR = "unsigned long long";
-		} else {
-			DECLTYPE_STR = "char";
-		}
+};
 
-		// Prepares pointers to direct translation.
-		const char *bfptr = bfcode;
-		char *cptr = ccode;
 
-		
-		// Prints code to the ccode str. Consists of pairs of sprintf and gotoend functions to print to the ccode str and relocate the pointer to the end of the new string.
-		// Prints header inclusions.
-		// The code depends on the conio.h header which is not part of the ANSI C standard.
-		sprintf(cptr, "#include <stdio.h>\n");
-		gotoend(&cptr);
-		sprintf(cptr, "#include <stdlib.h>\n");
-		gotoend(&cptr);
-		sprintf(cptr, "#include <stddef.h>\n");
-		gotoend(&cptr);
-		sprintf(cptr, "#include \"conio.h\"\n");
-		gotoend(&cptr);
-		sprintf(cptr, "\n");
-		gotoend(&cptr);
-		
-		// Prints the preparative codes of the program according to the configurations of the xl_brainfuck_env instance.
-		// Stores the current level of indentation, which shall be incremented or decremented when a nested block is entered or exited.
-		int indentlevel = 0;
 
-		for (int i = 0; i < indentlevel; i++) {
-			sprintf(cptr, "\t");
-			gotoend(&cptr);
-		}
-		sprintf(cptr, "int main() {\n");
-		gotoend(&cptr);
-		indentlevel++;
-		for (int i = 0; i < indentlevel; i++) {
-			sprintf(cptr, "\t");
-			gotoend(&cptr);
-		}
-		sprintf(cptr, "\n");
-		gotoend(&cptr);
-		for (int i = 0; i < indentlevel; i++) {
-			sprintf(cptr, "\t");
-			gotoend(&cptr);
-		}
-		sprintf(cptr, "%s *tape = (%s *)calloc(%d, sizeof(%s));\n",
-			DECLTYPE_STR, DECLTYPE_STR, this->maxaddr - this->minaddr + 1, DECLTYPE_STR);
-		gotoend(&cptr);
-		for (int i = 0; i < indentlevel; i++) {
-			sprintf(cptr, "\t");
-			gotoend(&cptr);
+// The xl_brainfuck_timeline class, which travels back and forth in an execution of a program on a brainfuck environment.
+// The position in the execution is the number of steps used, see xl_brainfuck_quota, and the execution pauses at the trips of loops, at the breakpoints of the program and at the watchpoints of the environment. Snapshots of the environment are taken periodically through its checkpointer, where a page of the tape which has not changed since the previous snapshot is shared with it, and the input is recorded as it is read. Moving back restores the latest snapshot before the target and replays the recorded input from there until the target is reached, passing over the breakpoints and watchpoints on the way.
+// The output is written once: output which the replay writes again is dropped. Memoization is disabled while the timeline exists, as it skips steps, and the timeline takes over the checkpointer, the stop step and the channels of the environment.
+template<typename storage_t>
+class xl_brainfuck_timeline {
+
+	// A point of the execution, at which it has used the steps and resumes at the bytecode offset.
+	// Between two trips of loops the execution only moves forward in the bytecode, hence the points are ordered by their steps first and their offsets next. The end of the execution has the largest offset.
+	struct point {
+		unsigned long long steps;
+		size_t offset;
+		bool operator<(const point &other) const {
+			return this->steps < other.steps || (this->steps == other.steps && this->offset < other.offset);
 		}
-		sprintf(cptr, "ptrdiff_t i = 0;\n");
-		gotoend(&cptr);
-		sprintf(cptr, "\n");
-		gotoend(&cptr);
+	};
 
-		ptrdiff_t offset = 0;
-		// Translates brainfuck codes to C code.
-		// Consecutive + and -, as well as > and <, will be congealed into a single C statement.
-		while (*bfptr != 0) {
+	// A snapshot of the environment, whose pages may be shared with other snapshots.
+	struct snapshot {
+		size_t ptroffset;
+		size_t bytecodeoffset;
+		xl_brainfuck_usage usage;
+		std::vector<std::shared_ptr<const std::vector<storage_t>>> pages;
+	};
 
-			switch (*bfptr) {
+	xl_brainfuck_env<storage_t> &env;
+	const xl_brainfuck_program &program;
+	xl_brainfuck_io io;
 
-			case '>': case '<': {
+	// The snapshots in the order of their steps, the first of which is the start of the execution, and the page of zero cells which all such pages share.
+	std::vector<snapshot> snapshots;
+	std::shared_ptr<const std::vector<storage_t>> zeropage;
+	size_t tapesize;
+	size_t pagecells;
+	double interval;
 
-				storage_t totaloffset = 0;
+	// The input read so far, the position of the next input read within it, and whether the input channel has reached its end.
+	std::vector<char> input;
+	size_t inputpos;
+	bool inputended;
 
-				const char *bfsearchptr = bfptr;
-				// Collates the total offset by consecutive > and < characters until an intervening character is reached.
-				while (true) {
-					if (*bfsearchptr == '>') {
-						totaloffset++;
-					} else if (*bfsearchptr == '<') {
-						totaloffset--;
-					} else {
-						break;
-					}
-					bfsearchptr++;
-				}
-				// Translates code only if total pointer offset is not zero.
-				for (int i = 0; i < indentlevel; i++) {
-					sprintf(cptr, "\t");
-					gotoend(&cptr);
-				}
-				if (totaloffset > 0) {
-					if (totaloffset == 1) {
-						sprintf(cptr, "i++;");
-						gotoend(&cptr);
-					}  else {
-						sprintf(cptr, "i += %d;", totaloffset);
-						gotoend(&cptr);
-					}
-				} else if (totaloffset < 0) {
-					if (totaloffset == -1) {
-						sprintf(cptr, "i--;");
-						gotoend(&cptr);
-					} else {
-						sprintf(cptr, "i -= %d;", -totaloffset);
-						gotoend(&cptr);
-					}
-				}
-				// The brainfuck code usually consists of pairs of ptr movement and ptr value assignment characters. To improve readability, one pair of pointer movement and assignment characters will be put on the same line.
-				if (*bfsearchptr == '+' || *bfsearchptr == '-') {
-					sprintf(cptr, " ");
-					gotoend(&cptr);
-				} else {
-					sprintf(cptr, "\n");
-					gotoend(&cptr);
-				}
-				bfptr = bfsearchptr;
-				break;
-			}
+	// The position of the next output written, and the output written so far, below which the output written again is dropped.
+	size_t outputpos;
+	size_t outputwritten;
 
-			case '+': case '-': {
+	// The usage at the start of the execution, from which the input and output positions count.
+	xl_brainfuck_usage startusage;
 
-				storage_t totalchange = 0;
+	// The status of the execution at the current position, which is STATUS_PAUSED unless it has ended.
+	int status;
 
-				const char *bfsearchptr = bfptr;
-				// Collates the total change by consecutive + and - characters until an intervening character is reached.
-				while (true) {
-					if (*bfsearchptr == '+') {
-						totalchange++;
-					} else if (*bfsearchptr == '-') {
-						totalchange--;
-					} else {
-						break;
-					}
-					bfsearchptr++;
-				}
-				// Translates code only if total change is not zero.
-				// Determines if the value assignment statement is preceded by a pointer movement statement, if yes, no indentation is printed into the C code string.
-				if (bfptr == bfcode ||
-					(bfptr[-1] != '>' && bfptr[-1] != '<')) {
-					for (int i = 0; i < indentlevel; i++) {
-						sprintf(cptr, "\t");
-						gotoend(&cptr);
-					}
-				}
-				if (totalchange > 0) {
-					if (totalchange == 1) {
-						sprintf(cptr, "tape[i]++;\n");
-						gotoend(&cptr);
-					} else {
-						sprintf(cptr, "tape[i] += %d;\n", totalchange);
-						gotoend(&cptr);
-					}
-				} else if (totalchange < 0) {
-					if (totalchange == -1) {
-						sprintf(cptr, "tape[i]--;\n");
-						gotoend(&cptr);
-					} else {
-						sprintf(cptr, "tape[i] -= %d;\n", -totalchange);
-						gotoend(&cptr);
-					}
-				}
-				bfptr = bfsearchptr;
-				break;
-			}
+	// Whether memoization was enabled in the environment before the timeline disabled it.
+	bool memoized;
 
-			case '.': {
-				for (int i = 0; i < indentlevel; i++) {
-					sprintf(cptr, "\t");
-					gotoend(&cptr);
-				}
-				strcpy(cptr, "printf(\"%%c\", tape[i]);\n");
-				gotoend(&cptr);
-				bfptr++;
-				break;
+public:
+
+	// Starts a timeline of the program from the current state of the environment, which reads its input from and writes its output to the channels.
+	xl_brainfuck_timeline(xl_brainfuck_env<storage_t> &env, const xl_brainfuck_program &program, const xl_brainfuck_io &io) :
+		env(env), program(program), io(io), inputpos(0), inputended(false), outputpos(0), outputwritten(0), status(STATUS_PAUSED) {
+		const xl_brainfuck_state<storage_t> state = env.getstate();
+		this->tapesize = state.tapesize;
+		this->pagecells = std::max<size_t>(TIMELINE_PAGE_SIZE / sizeof(storage_t), 1);
+		this->zeropage = std::make_shared<const std::vector<storage_t>>(this->pagecells, (storage_t)0);
+		this->interval = TIMELINE_SNAPSHOT_INTERVAL;
+		this->startusage = state.usage;
+		this->snapshots.push_back(this->capture({ state.tape, state.tapesize, state.ptroffset, 0, state.usage }));
+		this->memoized = env.getmemoization();
+		this->env.setmemoization(false);
+		this->env.setio({ xl_brainfuck_timeline::write, xl_brainfuck_timeline::read, this });
+		this->env.setcheckpointer({ xl_brainfuck_timeline::save, this, this->interval });
+	}
+
+	// Leaves the environment in the state of the current position, with memoization as it was before the timeline and the channels given to the timeline.
+	~xl_brainfuck_timeline() {
+		this->env.setcheckpointer({ nullptr, nullptr, 0 });
+		this->env.setstop(0);
+		this->env.setio(this->io);
+		this->env.setmemoization(this->memoized);
+	}
+
+	// Returns the current position, which counts the steps from the start of the execution.
+	unsigned long long position() {
+		return this->env.getusage().steps - this->startusage.steps;
+	}
+
+	// Returns the status of the execution at the current position, which is STATUS_PAUSED unless the execution has ended.
+	int getstatus() {
+		return this->status;
+	}
+
+	// Runs the execution forward by the steps, or to its end if the steps are zero, and returns the status at the new position.
+	// The execution pauses at the first trip of a loop at or after the target, or at a breakpoint or watchpoint before it.
+	int forward(unsigned long long steps) {
+		if (this->status != STATUS_PAUSED) {
+			return this->status;
+		}
+		return this->advance(steps == 0 ? 0 : this->env.getusage().steps + steps);
+	}
+
+	// Moves the execution back by the steps, to the first point at or after the target at which it pauses, and returns the status at the new position.
+	// If no such point lies between the target and the current position, the target moves further back, so that the position always moves back unless it is the start.
+	int backward(unsigned long long steps) {
+		const point current = this->current();
+		unsigned long long distance = std::max<unsigned long long>(steps, 1);
+		while (true) {
+			const unsigned long long target = current.steps - std::min(distance, current.steps - this->startusage.steps);
+			this->seek({ target, 0 });
+			if (this->current() < current || target == this->startusage.steps) {
+				return this->status;
 			}
+			distance *= 2;
+		}
+	}
 
-			case ',': {
-				for (int i = 0; i < indentlevel; i++) {
-					sprintf(cptr, "\t");
-					gotoend(&cptr);
-				}
-				sprintf(cptr, "tape[i] = _getch();\n");
-				gotoend(&cptr);
-				bfptr++;
-				break;
+	// Moves the execution back to right after the latest instruction before the current position which changed the cell at the offset from the start of the tape.
+	// The snapshots are searched from the latest backwards, and the execution from each is replayed with a watchpoint on the cell. Returns false if the cell never changed, in which case the position is kept.
+	bool backtochange(size_t celloffset) {
+		if (celloffset >= this->tapesize) {
+			return false;
+		}
+		const point current = this->current();
+		const bool iswatched = this->env.iswatchpoint(celloffset);
+		this->env.setwatchpoint(celloffset, true);
+		point end = current;
+		point found = { 0, 0 };
+		bool isfound = false;
+		size_t index = this->snapshots.size();
+		while (index > 0 && !isfound) {
+			index--;
+			const point from = { this->snapshots[index].usage.steps, this->snapshots[index].bytecodeoffset };
+			if (from < end) {
+				isfound = this->findchange(index, celloffset, end, found);
+				end = from;
 			}
+		}
+		this->seek(isfound ? found : current);
+		this->env.setwatchpoint(celloffset, iswatched);
+		return isfound;
+	}
 
-			case '[': {
-				for (int i = 0; i < indentlevel; i++) {
-					sprintf(cptr, "\t");
-					gotoend(&cptr);
-				}
-				sprintf(cptr, "while (tape[i] != 0) {\n");
-				indentlevel++;
-				gotoend(&cptr);
-				bfptr++;
-				break;
+private:
+
+	// Returns the current point of the execution.
+	point current() {
+		return { this->env.getusage().steps, this->status == STATUS_PAUSED ? this->env.getstate().bytecodeoffset : (size_t)-1 };
+	}
+
+	// Moves the execution to the first point at or after the target at which it pauses, from the current position if it lies before the target, and from the latest snapshot at or before the target otherwise.
+	void seek(const point &target) {
+		if (this->status != STATUS_PAUSED || target < this->current()) {
+			size_t index = this->snapshots.size() - 1;
+			while (target < point{ this->snapshots[index].usage.steps, this->snapshots[index].bytecodeoffset }) {
+				index--;
 			}
+			this->restore(this->snapshots[index]);
+		}
+		while (this->status == STATUS_PAUSED && this->current() < target) {
+			this->advance(this->env.getusage().steps < target.steps ? target.steps : 0);
+		}
+	}
 
-			case ']': {
-				indentlevel--;
-				for (int i = 0; i < indentlevel; i++) {
-					sprintf(cptr, "\t");
-					gotoend(&cptr);
-				}
-				sprintf(cptr, "}\n");
-				gotoend(&cptr);
-				bfptr++;
+	// Runs the execution from the current position until the target step, or to its end if the target is zero, unless it pauses before.
+	int advance(unsigned long long target) {
+		this->env.setstop(target);
+		this->status = this->env.execute(this->program, this->env.getstate().bytecodeoffset);
+		this->env.setstop(0);
+		return this->status;
+	}
+
+	// Replays the execution from the snapshot until the end point with a watchpoint on the cell, and finds the point right after the latest change of the cell before the end. Returns false if there is none.
+	bool findchange(size_t index, size_t celloffset, const point &end, point &found) {
+		this->restore(this->snapshots[index]);
+		storage_t value = this->env.getstate().tape[celloffset];
+		bool isfound = false;
+		while (this->status == STATUS_PAUSED) {
+			this->advance(this->env.getusage().steps < end.steps ? end.steps : 0);
+			const point paused = this->current();
+			if (!(paused < end)) {
 				break;
 			}
-
-			default: {
-				bfptr++;
+			if (this->env.getstate().tape[celloffset] != value) {
+				value = this->env.getstate().tape[celloffset];
+				found = paused;
+				isfound = true;
 			}
+		}
+		return isfound;
+	}
 
+	// Takes a snapshot of the state, sharing the pages which are zero or unchanged since the latest snapshot.
+	snapshot capture(const xl_brainfuck_state<storage_t> &state) {
+		snapshot taken = { state.ptroffset, state.bytecodeoffset, state.usage, {} };
+		const snapshot *previous = this->snapshots.empty() ? nullptr : &this->snapshots.back();
+		for (size_t start = 0; start < state.tapesize; start += this->pagecells) {
+			const size_t size = std::min(this->pagecells, state.tapesize - start) * sizeof(storage_t);
+			const storage_t *cells = state.tape + start;
+			const size_t page = start / this->pagecells;
+			if (previous != nullptr && memcmp(previous->pages[page]->data(), cells, size) == 0) {
+				taken.pages.push_back(previous->pages[page]);
+			} else if (memcmp(this->zeropage->data(), cells, size) == 0) {
+				taken.pages.push_back(this->zeropage);
+			} else {
+				taken.pages.push_back(std::make_shared<const std::vector<storage_t>>(cells, cells + size / sizeof(storage_t)));
 			}
-
 		}
+		return taken;
+	}
 
-		// Appends the ending for the C program.
-		for (int i = 0; i < indentlevel; i++) {
-			sprintf(cptr, "\t");
-			gotoend(&cptr);
-		}
-		sprintf(cptr, "\n");
-		gotoend(&cptr);
-		for (int i = 0; i < indentlevel; i++) {
-			sprintf(cptr, "\t");
-			gotoend(&cptr);
+	// Restores the environment and the input and output positions from the snapshot.
+	void restore(const snapshot &from) {
+		std::vector<storage_t> tape(this->tapesize);
+		for (size_t page = 0; page < from.pages.size(); page++) {
+			const size_t start = page * this->pagecells;
+			memcpy(tape.data() + start, from.pages[page]->data(), std::min(this->pagecells, this->tapesize - start) * sizeof(storage_t));
 		}
-		sprintf(cptr, "free(tape);\n");
-		gotoend(&cptr);
-		for (int i = 0; i < indentlevel; i++) {
-			sprintf(cptr, "\t");
-			gotoend(&cptr);
+		this->env.restore({ tape.data(), this->tapesize, from.ptroffset, from.bytecodeoffset, from.usage });
+		this->inputpos = from.usage.inputbytes - this->startusage.inputbytes;
+		this->outputpos = from.usage.outputbytes - this->startusage.outputbytes;
+		this->status = STATUS_PAUSED;
+	}
+
+	// Records each snapshot handed over by the checkpointer of the environment past the latest one.
+	static void save(void *context, const xl_brainfuck_state<storage_t> &state) {
+		xl_brainfuck_timeline *timeline = (xl_brainfuck_timeline *)context;
+		if (state.usage.steps <= timeline->snapshots.back().usage.steps) {
+			return;
 		}
-		sprintf(cptr, "_getch();\n");
-		gotoend(&cptr);
-		for (int i = 0; i < indentlevel; i++) {
-			sprintf(cptr, "\t");
-			gotoend(&cptr);
+		timeline->snapshots.push_back(timeline->capture(state));
+		if (timeline->snapshots.size() > TIMELINE_MAX_SNAPSHOTS) {
+			for (size_t index = 1; 2 * index < timeline->snapshots.size(); index++) {
+				timeline->snapshots[index] = std::move(timeline->snapshots[2 * index]);
+			}
+			timeline->snapshots.resize((timeline->snapshots.size() + 1) / 2);
+			timeline->interval *= 2;
+			timeline->env.setcheckpointer({ xl_brainfuck_timeline::save, timeline, timeline->interval });
 		}
-		sprintf(cptr, "\n");
-		gotoend(&cptr);
-		for (int i = 0; i < indentlevel; i++) {
-			sprintf(cptr, "\t");
-			gotoend(&cptr);
+	}
+
+	// Replays the input read before, and records the input read past it.
+	static int read(void *context) {
+		xl_brainfuck_timeline *timeline = (xl_brainfuck_timeline *)context;
+		if (timeline->inputpos < timeline->input.size()) {
+			return (unsigned char)timeline->input[timeline->inputpos++];
 		}
-		sprintf(cptr, "return 0;\n");
-		gotoend(&cptr);
-		for (int i = 0; i < indentlevel; i++) {
-			sprintf(cptr, "\t");
-			gotoend(&cptr);
+		if (timeline->inputended) {
+			return EOF;
 		}
-		sprintf(cptr, "\n");
-		gotoend(&cptr);
-		indentlevel--;
-		for (int i = 0; i < indentlevel; i++) {
-			sprintf(cptr, "\t");
-			gotoend(&cptr);
+		const int input = timeline->io.read(timeline->io.context);
+		if (input == EOF) {
+			timeline->inputended = true;
+			return EOF;
 		}
-		sprintf(cptr, "}\n");
-		gotoend(&cptr);
-
-		// Assess if there is any errors in the indentation, i.e. errors with unenclosed loops.
-		return indentlevel == 0 ? 0 : 1;
-
+		timeline->input.push_back((char)input);
+		timeline->inputpos++;
+		return input;
 	}
 
-	// Manually resets the internal state of the brainfuck environment, where all storage units will be reinitialized to zero and the pointer to the start position of the memory block.
-	void reset() {
-		for (storage_t *resetptr = this->minaddr; resetptr <= this->maxaddr; resetptr++) {
-			*resetptr = 0;
+	// Drops the output written before, and writes the output past it.
+	static void write(void *context, const char *data, size_t size) {
+		xl_brainfuck_timeline *timeline = (xl_brainfuck_timeline *)context;
+		const size_t end = timeline->outputpos + size;
+		if (end > timeline->outputwritten) {
+			const size_t skipped = timeline->outputwritten > timeline->outputpos ? timeline->outputwritten - timeline->outputpos : 0;
+			timeline->io.write(timeline->io.context, data + skipped, size - skipped);
+			timeline->outputwritten = end;
 		}
-		this->ptr = this->minaddr;
-	}
-
-	// Determines if the current pointer position is out of range.
-	bool ptroutofrange() {
-		return this->ptr < this->minaddr || this->ptr > this->maxaddr;
+		timeline->outputpos = end;
 	}
 
 };
\ No newline at end of file